@@ -0,0 +1,90 @@
+// Body compression, bytes against CPU, on the SEND bodies of the reports given on the command
+// line (built by buildSendFrame, compression off). For each threshold and deflate level:
+// the bodies at or above the threshold are deflated and kept if that made them smaller,
+// as StompProtocol does, and the table shows the bytes saved over all bodies and the cost
+// per compressed body of compress and of decompress (the subscriber's side).
+// Built with the client's flags, so the numbers are for the client as shipped.
+#include "../include/DeflateCodec.h"
+#include "../include/FrameView.h"
+#include "../include/StompProtocol.h"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int ROUNDS = 200;
+static const size_t THRESHOLDS[] = { 0, 256, 512, 1024 };
+static const int LEVELS[] = { 1, 6, 9 };
+
+static double nsSince(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::duration<double, std::nano>>(Clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+        files.push_back(argv[i]);
+    if (files.empty())
+        files.push_back("data/events1.json");
+
+    StompProtocol protocol;
+    std::vector<std::string> bodies;
+    size_t rawBytes = 0;
+    for (const std::string &file : files) {
+        names_and_events report = parseEventsFile(file);
+        std::string topic = "/" + report.team_a_name + "_" + report.team_b_name;
+        for (const Event &event : report.events) {
+            std::string frame = protocol.buildSendFrame(topic, event, "bench", file);
+            bodies.push_back(frame.substr(frame.find("\n\n") + 2));
+            rawBytes += bodies.back().size();
+        }
+    }
+    if (bodies.empty()) {
+        std::cerr << "no events in the input files" << std::endl;
+        return 1;
+    }
+    std::cout << bodies.size() << " bodies, " << rawBytes << " bytes, " << ROUNDS << " rounds" << std::endl;
+    std::cout << "  threshold  level  compressed  bytes sent   saved  compress ns  decompress ns" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (size_t threshold : THRESHOLDS) {
+        for (int level : LEVELS) {
+            size_t sent = 0, compressedBodies = 0;
+            double compressNs = 0, decompressNs = 0;
+            std::string packed, unpacked;
+            for (const std::string &body : bodies) {
+                if (body.size() < threshold || !DeflateCodec::compress(body, packed, level) ||
+                    packed.size() >= body.size()) {
+                    sent += body.size();
+                    continue;
+                }
+                sent += packed.size();
+                compressedBodies++;
+
+                Clock::time_point start = Clock::now();
+                for (int round = 0; round < ROUNDS; round++)
+                    DeflateCodec::compress(body, packed, level);
+                compressNs += nsSince(start) / ROUNDS;
+
+                start = Clock::now();
+                for (int round = 0; round < ROUNDS; round++) {
+                    if (!DeflateCodec::decompress(packed.data(), packed.size(), unpacked, FrameView::MAX_FRAME_SIZE) ||
+                        unpacked != body) {
+                        std::cerr << "round trip failed" << std::endl;
+                        return 1;
+                    }
+                }
+                decompressNs += nsSince(start) / ROUNDS;
+            }
+            double perBody = compressedBodies == 0 ? 1 : static_cast<double>(compressedBodies);
+            std::string ratio = std::to_string(compressedBodies) + "/" + std::to_string(bodies.size());
+            std::cout << "  " << std::setw(9) << threshold << std::setw(7) << level << std::setw(12) << ratio
+                      << std::setw(12) << sent << std::setw(7) << 100.0 * (rawBytes - sent) / rawBytes << '%'
+                      << std::setw(13) << compressNs / perBody << std::setw(15) << decompressNs / perBody << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,121 @@
+// Frame dispatch, in frames/sec, on a stream of server frames built from the reports given on
+// the command line: one MESSAGE per event (as the broker relays a SEND), each followed by the
+// RECEIPT for it, plus a CONNECTED. Both variants do what the reader thread needs before a
+// handler runs: find the command, the receipt-id / heart-beat value or the start of the body.
+//  strings:   the reader before FrameView got its command enum and header table:
+//             substr(0, N) == "..." per command, find("receipt-id:"), and a find('\n') / substr
+//             line loop to skip the MESSAGE headers
+//  FrameView: FrameView::parse (one pass: command, header table, body offset), then a switch
+// The Event parse of the body is the same in both and not included (see MessageParseBench).
+#include "../include/FrameView.h"
+#include "../include/StompProtocol.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int ROUNDS = 2000;
+
+static size_t dispatchStrings(const std::string &frame) {
+    if (frame.substr(0, 9) == "CONNECTED") {
+        size_t pos = frame.find("heart-beat:");
+        if (pos == std::string::npos)
+            return 0;
+        std::string value = frame.substr(pos + 11);
+        return value.substr(0, value.find('\n')).size();
+    } else if (frame.substr(0, 5) == "ERROR") {
+        return 1;
+    } else if (frame.substr(0, 7) == "MESSAGE") {
+        // skip the headers: the body starts after the first empty line
+        size_t startPos = 0;
+        size_t endPos = frame.find('\n');
+        while (endPos != std::string::npos) {
+            std::string line = frame.substr(startPos, endPos - startPos);
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            startPos = endPos + 1;
+            if (line.empty())
+                break;
+            endPos = frame.find('\n', startPos);
+        }
+        return startPos;
+    } else if (frame.substr(0, 7) == "RECEIPT") {
+        size_t pos = frame.find("receipt-id:");
+        if (pos == std::string::npos)
+            return 0;
+        std::string receiptId = frame.substr(pos + 11);
+        return receiptId.substr(0, receiptId.find('\n')).size();
+    }
+    return 0;
+}
+
+static size_t dispatchFrameView(FrameView &view, const std::string &frame) {
+    if (!view.parse(frame.data(), frame.size()))
+        return 0;
+    switch (view.type) {
+    case FrameView::Connected: return view.header(FrameView::HeartBeat).size;
+    case FrameView::Error: return 1;
+    case FrameView::Message: return view.bodyOffset;
+    case FrameView::Receipt: return view.header(FrameView::ReceiptId).size;
+    default: return 0;
+    }
+}
+
+template <typename Dispatch>
+static double framesPerSecond(const std::vector<std::string> &frames, size_t &checksum, Dispatch dispatch) {
+    Clock::time_point start = Clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (const std::string &frame : frames)
+            checksum += dispatch(frame);
+    }
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(Clock::now() - start).count();
+    return static_cast<double>(ROUNDS) * frames.size() / seconds;
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+        files.push_back(argv[i]);
+    if (files.empty())
+        files.push_back("data/events1.json");
+
+    StompProtocol protocol;
+    std::vector<std::string> frames;
+    frames.push_back("CONNECTED\nversion:1.2\nheart-beat:1000,1000\n\n");
+    int messageId = 0;
+    for (const std::string &file : files) {
+        names_and_events report = parseEventsFile(file);
+        std::string topic = "/" + report.team_a_name + "_" + report.team_b_name;
+        for (const Event &event : report.events) {
+            std::string send = protocol.buildSendFrame(topic, event, "bench", file);
+            std::string body = send.substr(send.find("\n\n") + 2);
+            messageId++;
+            frames.push_back("MESSAGE\nsubscription:0\nmessage-id:" + std::to_string(messageId) +
+                             "\ndestination:" + topic + "\ncontent-length:" + std::to_string(body.size()) +
+                             "\n\n" + body);
+            frames.push_back("RECEIPT\nreceipt-id:" + std::to_string(messageId) + "\n\n");
+        }
+    }
+    if (messageId == 0) {
+        std::cerr << "no events in the input files" << std::endl;
+        return 1;
+    }
+    std::cout << frames.size() << " frames (" << messageId << " MESSAGE), " << ROUNDS << " rounds" << std::endl;
+
+    size_t stringsSum = 0, viewSum = 0;
+    double strings = framesPerSecond(frames, stringsSum, dispatchStrings);
+    FrameView view;
+    double parsed = framesPerSecond(frames, viewSum, [&view](const std::string &frame) {
+        return dispatchFrameView(view, frame);
+    });
+
+    std::cout << "  strings:   " << strings << " frames/s" << std::endl;
+    std::cout << "  FrameView: " << parsed << " frames/s" << std::endl;
+    if (stringsSum != viewSum) {
+        std::cerr << "the variants disagree (" << stringsSum << " vs " << viewSum << ")" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,170 @@
+// Key classification, in ns per key, for the three places that dispatch on known strings:
+//  commands:  the command line of each server frame (a MESSAGE and a RECEIPT per event,
+//             one CONNECTED, one ERROR)
+//  headers:   every header name of those frames
+//  body keys: every line of the MESSAGE bodies up to "description:"
+// Each is timed as an if/else chain (one compare per candidate, in order) and as a keyHash
+// switch (one hash, one compare). The client uses whichever is faster here: the chain for
+// commands (FrameView::classifyCommand) and body keys (classifyBodyLine in event.cpp, copied
+// below as bodyChain since it is internal to that file), the switch for header names
+// (FrameView::classifyHeader). The other variant of each group is the bench's own.
+#include "../include/FrameView.h"
+#include "../include/KeyHash.h"
+#include "../include/StompProtocol.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int ROUNDS = 20000;
+
+static int commandHashed(const StringView &command) {
+    switch (keyHash(command)) {
+    case keyHash("MESSAGE"): return command == "MESSAGE" ? FrameView::Message : FrameView::UnknownCommand;
+    case keyHash("RECEIPT"): return command == "RECEIPT" ? FrameView::Receipt : FrameView::UnknownCommand;
+    case keyHash("CONNECTED"): return command == "CONNECTED" ? FrameView::Connected : FrameView::UnknownCommand;
+    case keyHash("ERROR"): return command == "ERROR" ? FrameView::Error : FrameView::UnknownCommand;
+    default: return FrameView::UnknownCommand;
+    }
+}
+
+static int headerChain(const StringView &name) {
+    static const char *const NAMES[FrameView::KNOWN_HEADERS] = {
+        "content-length", "content-encoding", "content-type", "receipt-id", "heart-beat",
+        "accept-encoding", "version", "subscription", "message-id", "destination"
+    };
+    for (int i = 0; i < FrameView::KNOWN_HEADERS; i++) {
+        if (name == NAMES[i])
+            return i;
+    }
+    return FrameView::KNOWN_HEADERS;
+}
+
+// Both body classifiers cut the line at its first ':' as the parser does, and return the
+// kind of the line and, for any other line (an update "key:value"), where its ':' is.
+static size_t otherLine(size_t colon) {
+    return 9 + 16 * (colon == StringView::npos ? 0 : colon);
+}
+
+// classifyBodyLine of event.cpp
+static size_t bodyChain(const StringView &line) {
+    size_t colon = line.find(':');
+    StringView key = line.substr(0, colon);
+    StringView value = colon == StringView::npos ? StringView() : line.substr(colon + 1);
+    if (value.startsWith(" ")) {
+        if (key == "user") return 0;
+        if (key == "team a") return 1;
+        if (key == "team b") return 2;
+        if (key == "event name") return 3;
+        if (key == "time") return 4;
+    } else if (colon != StringView::npos && value.empty()) {
+        if (key == "general game updates") return 5;
+        if (key == "team a updates") return 6;
+        if (key == "team b updates") return 7;
+        if (key == "description") return 8;
+    }
+    return otherLine(colon);
+}
+
+static size_t bodyHashed(const StringView &line) {
+    size_t colon = line.find(':');
+    StringView key = line.substr(0, colon);
+    StringView value = colon == StringView::npos ? StringView() : line.substr(colon + 1);
+    bool field = value.startsWith(" ");
+    bool header = colon != StringView::npos && value.empty();
+    switch (keyHash(key)) {
+    case keyHash("user"): return field && key == "user" ? 0 : otherLine(colon);
+    case keyHash("team a"): return field && key == "team a" ? 1 : otherLine(colon);
+    case keyHash("team b"): return field && key == "team b" ? 2 : otherLine(colon);
+    case keyHash("event name"): return field && key == "event name" ? 3 : otherLine(colon);
+    case keyHash("time"): return field && key == "time" ? 4 : otherLine(colon);
+    case keyHash("general game updates"): return header && key == "general game updates" ? 5 : otherLine(colon);
+    case keyHash("team a updates"): return header && key == "team a updates" ? 6 : otherLine(colon);
+    case keyHash("team b updates"): return header && key == "team b updates" ? 7 : otherLine(colon);
+    case keyHash("description"): return header && key == "description" ? 8 : otherLine(colon);
+    default: return otherLine(colon);
+    }
+}
+
+template <typename Classify>
+static double nsPerKey(const std::vector<StringView> &keys, size_t &checksum, Classify classify) {
+    Clock::time_point start = Clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (const StringView &key : keys)
+            checksum += classify(key);
+    }
+    double ns = std::chrono::duration_cast<std::chrono::duration<double, std::nano>>(Clock::now() - start).count();
+    return ns / (static_cast<double>(ROUNDS) * keys.size());
+}
+
+template <typename Chain, typename Hashed>
+static bool compare(const char *what, const std::vector<StringView> &keys, Chain chain, Hashed hashed) {
+    size_t chainSum = 0, hashedSum = 0;
+    double chainNs = nsPerKey(keys, chainSum, chain);
+    double hashedNs = nsPerKey(keys, hashedSum, hashed);
+    std::cout << "  " << what << " (" << keys.size() << "): chain " << chainNs << " ns, hash "
+              << hashedNs << " ns" << std::endl;
+    if (chainSum != hashedSum) {
+        std::cerr << what << ": the variants disagree (" << chainSum << " vs " << hashedSum << ")" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+        files.push_back(argv[i]);
+    if (files.empty())
+        files.push_back("data/events1.json");
+
+    StompProtocol protocol;
+    std::vector<std::string> frames, bodies;
+    frames.push_back("CONNECTED\nversion:1.2\nheart-beat:1000,1000\n\n");
+    frames.push_back("ERROR\nmessage:malformed frame received\nreceipt-id:7\n\n");
+    for (const std::string &file : files) {
+        names_and_events report = parseEventsFile(file);
+        std::string topic = "/" + report.team_a_name + "_" + report.team_b_name;
+        for (const Event &event : report.events) {
+            std::string send = protocol.buildSendFrame(topic, event, "bench", file);
+            bodies.push_back(send.substr(send.find("\n\n") + 2));
+            frames.push_back("MESSAGE\nsubscription:0\nmessage-id:" + std::to_string(bodies.size()) +
+                             "\ndestination:" + topic + "\ncontent-length:" +
+                             std::to_string(bodies.back().size()) + "\n\n" + bodies.back());
+            frames.push_back("RECEIPT\nreceipt-id:" + std::to_string(bodies.size()) + "\n\n");
+        }
+    }
+    if (bodies.empty()) {
+        std::cerr << "no events in the input files" << std::endl;
+        return 1;
+    }
+
+    // the keys point into frames and bodies, which stay put from here on
+    std::vector<FrameView> views(frames.size());
+    std::vector<StringView> commands, headers, lines;
+    for (size_t i = 0; i < frames.size(); i++) {
+        views[i].parse(frames[i].data(), frames[i].size());
+        commands.push_back(views[i].command);
+        for (const std::pair<StringView, StringView> &header : views[i].headers)
+            headers.push_back(header.first);
+    }
+    for (const std::string &body : bodies) {
+        StringView text(body.data(), body.size());
+        size_t start = 0, end;
+        while ((end = text.find('\n', start)) != StringView::npos) {
+            StringView line = text.substr(start, end - start);
+            lines.push_back(line);
+            if (line == "description:")
+                break;
+            start = end + 1;
+        }
+    }
+    std::cout << ROUNDS << " rounds, ns per key" << std::endl;
+
+    bool agree = compare("commands", commands, FrameView::classifyCommand, commandHashed);
+    agree = compare("headers", headers, headerChain, FrameView::classifyHeader) && agree;
+    agree = compare("body keys", lines, bodyChain, bodyHashed) && agree;
+    return agree ? 0 : 1;
+}
@@ -0,0 +1,105 @@
+// Request/receipt round trip per socket profile, over loopback TCP: the client queues a SEND with
+// a receipt header (the writer thread sends it, as for a report) and its reader waits for the
+// RECEIPT (getFrameView), one frame in flight at a time. The broker answers every SEND at once
+// with Nagle off, so the differences are the client's.
+//  default, low-latency, throughput: SocketProfile::fromName, as --profile
+//  busy-poll:     low-latency with --busy-poll 50
+//  pinned reader: low-latency with --cpu 0
+// Each profile runs with the client's write coalescing (--coalesce 200,65536: a SEND that follows
+// the previous write within 200 us waits up to 200 us for more) and without it (--coalesce 0,...).
+// For each: p50 / p99 / mean round trip in microseconds.
+// Usage: LatencyBench [round trips] [body bytes]
+#include "../include/ConnectionHandler.h"
+#include "../test/LoopbackBroker.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// broker session: one RECEIPT per '\0'-terminated frame, until the client closes the connection
+static void answerReceipts(LoopbackBroker::tcp::socket &socket) {
+    boost::system::error_code error;
+    socket.set_option(LoopbackBroker::tcp::no_delay(true), error);
+    char chunk[64 * 1024];
+    unsigned long receipts = 0;
+    while (!error) {
+        size_t length = socket.read_some(boost::asio::buffer(chunk), error);
+        std::string replies;
+        for (size_t i = 0; i < length; i++) {
+            if (chunk[i] == '\0')
+                replies += "RECEIPT\nreceipt-id:" + std::to_string(++receipts) + "\n\n" + '\0';
+        }
+        if (!replies.empty())
+            boost::asio::write(socket, boost::asio::buffer(replies), error);
+    }
+}
+
+static void latencyBench(const SocketProfile &profile, const char *name, int coalesceUs, int roundTrips,
+                         const std::string &body) {
+    LoopbackBroker broker(answerReceipts);
+    ConnectionHandler handler("127.0.0.1", broker.port());
+    handler.setSocketProfile(profile);
+    handler.setWriteCoalescing(std::chrono::microseconds(coalesceUs), 64 * 1024);
+    if (!handler.connect()) {
+        broker.abandon();
+        return;
+    }
+    handler.pinReaderThread();
+
+    std::vector<double> micros;
+    micros.reserve(roundTrips);
+    FrameView view;
+    for (int i = 1; i <= roundTrips; i++) {
+        std::string frame = "SEND\ndestination:/bench\nreceipt:" + std::to_string(i) + "\ncontent-length:" +
+                            std::to_string(body.size()) + "\n\n" + body;
+        Clock::time_point start = Clock::now();
+        if (!handler.queueFrame(std::move(frame), '\0'))
+            break;
+        bool answered = false;
+        while (!answered && handler.getFrameView(view))
+            answered = view.type == FrameView::Receipt;
+        if (!answered)
+            break;
+        micros.push_back(std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(Clock::now() - start).count());
+    }
+    handler.close();
+    broker.finish();
+    if (micros.empty()) {
+        std::cout << "  " << name << ": no receipts" << std::endl;
+        return;
+    }
+
+    double total = 0;
+    for (double us : micros)
+        total += us;
+    std::sort(micros.begin(), micros.end());
+    std::cout << "  " << name << ": p50 " << micros[micros.size() / 2] << " us, p99 "
+              << micros[micros.size() * 99 / 100] << " us, mean " << total / micros.size() << " us ("
+              << micros.size() << " round trips)" << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    int roundTrips = argc > 1 ? std::atoi(argv[1]) : 20000;
+    size_t bodySize = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 512;
+    std::string body(bodySize, 'x');
+    std::cout << roundTrips << " SEND/RECEIPT round trips, " << bodySize << " byte bodies" << std::endl;
+
+    SocketProfile busyPoll = SocketProfile::lowLatency();
+    busyPoll.busyPollMicros = 50;
+    SocketProfile pinned = SocketProfile::lowLatency();
+    pinned.readerCpu = 0;
+    const int COALESCE_US[] = { 200, 0 };
+    for (int coalesceUs : COALESCE_US) {
+        std::cout << "coalescing " << coalesceUs << " us" << std::endl;
+        latencyBench(SocketProfile(), "default      ", coalesceUs, roundTrips, body);
+        latencyBench(SocketProfile::lowLatency(), "low-latency  ", coalesceUs, roundTrips, body);
+        latencyBench(SocketProfile::throughput(), "throughput   ", coalesceUs, roundTrips, body);
+        latencyBench(busyPoll, "busy-poll    ", coalesceUs, roundTrips, body);
+        latencyBench(pinned, "pinned reader", coalesceUs, roundTrips, body);
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+// MESSAGE body parsing, per body, on the reports given on the command line (bodies built by
+// buildSendFrame, exactly as a subscriber receives them):
+//  split:  the line loop of Event::index_body, only the '\n' / ':' lookups (StringView::find)
+//  Event:  Event(body), the complete parse the client runs per MESSAGE
+// Built with the client's flags, so the numbers are for the client as shipped.
+#include "../include/StompProtocol.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int ROUNDS = 2000;
+
+// returns the number of "key: value" lines in front of the description, so the work
+// cannot be skipped
+static size_t splitLines(const StringView &text) {
+    size_t pairs = 0;
+    size_t startPos = 0;
+    size_t endPos = text.find('\n');
+    while (endPos != StringView::npos) {
+        StringView line = text.substr(startPos, endPos - startPos);
+        size_t colonPos = line.find(':');
+        if (colonPos != StringView::npos) {
+            if (line.substr(0, colonPos) == "description")
+                break;
+            pairs++;
+        }
+        startPos = endPos + 1;
+        endPos = text.find('\n', startPos);
+    }
+    return pairs;
+}
+
+template <typename Parse>
+static double nsPerBody(const std::vector<std::string> &bodies, size_t &checksum, Parse parse) {
+    Clock::time_point start = Clock::now();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (const std::string &body : bodies)
+            checksum += parse(body);
+    }
+    double ns = std::chrono::duration_cast<std::chrono::duration<double, std::nano>>(Clock::now() - start).count();
+    return ns / (static_cast<double>(ROUNDS) * bodies.size());
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+        files.push_back(argv[i]);
+    if (files.empty())
+        files.push_back("data/events1.json");
+
+    StompProtocol protocol;
+    std::vector<std::string> bodies;
+    size_t bytes = 0;
+    for (const std::string &file : files) {
+        names_and_events report = parseEventsFile(file);
+        std::string topic = "/" + report.team_a_name + "_" + report.team_b_name;
+        for (const Event &event : report.events) {
+            std::string frame = protocol.buildSendFrame(topic, event, "bench", file);
+            bodies.push_back(frame.substr(frame.find("\n\n") + 2));
+            bytes += bodies.back().size();
+        }
+    }
+    if (bodies.empty()) {
+        std::cerr << "no events in the input files" << std::endl;
+        return 1;
+    }
+    std::cout << bodies.size() << " bodies, " << bytes / bodies.size() << " bytes on average, "
+              << ROUNDS << " rounds" << std::endl;
+
+    size_t checksum = 0;
+    double split = nsPerBody(bodies, checksum, [](const std::string &body) {
+        return splitLines(StringView(body.data(), body.size()));
+    });
+    double event = nsPerBody(bodies, checksum, [](const std::string &body) {
+        Event parsed(body);
+        return parsed.get_time() >= 0 ? 1u : 0u;
+    });
+
+    std::cout << "  split: " << split << " ns/body" << std::endl;
+    std::cout << "  Event: " << event << " ns/body" << std::endl;
+    std::cout << "  (checksum " << checksum << ")" << std::endl;
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Blocking-mode transport throughput, Boost sockets against io_uring, over loopback TCP:
+//  write: the writer thread drains FRAMES queued SENDs into a broker that only reads
+//  read:  the reader takes FRAMES MESSAGEs (getFrameView) from a broker that only writes
+// For each: frames/s, MB/s, and the system calls made (read_some / write_some for Boost,
+// io_uring_enter for io_uring; IoStats readCalls / writeCalls).
+// Usage: TransportBench [frames] [body bytes]
+#include "../include/ConnectionHandler.h"
+#include "../test/LoopbackBroker.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+// broker session: writes 'frames' frames, a few per write as a broker flushing its queue
+// would, then closes the connection
+static void writeFrames(LoopbackBroker::tcp::socket &socket, const std::string &frame, int frames) {
+    std::string burst;
+    for (int i = 0; i < 16; i++)
+        burst += frame;
+    boost::system::error_code error;
+    for (int sent = 0; sent < frames && !error; sent += 16)
+        boost::asio::write(socket, boost::asio::buffer(burst), error);
+    socket.close(error);
+}
+
+static void report(const char *what, int frames, size_t bytes, double seconds, unsigned long long calls) {
+    std::cout << "  " << what << ": " << frames / seconds << " frames/s, " << bytes / seconds / 1e6
+              << " MB/s, " << calls << " system calls (" << static_cast<double>(bytes) / calls
+              << " bytes each)" << std::endl;
+}
+
+static bool connectWith(ConnectionHandler &handler, bool useIoUring, const char *name) {
+    handler.setUseIoUring(useIoUring);
+    if (!handler.connect())
+        return false;
+    if (useIoUring && !handler.isUsingIoUring()) {
+        std::cout << name << ": io_uring unavailable" << std::endl;
+        handler.close();
+        return false;
+    }
+    return true;
+}
+
+static void writeBench(bool useIoUring, const char *name, int frames, const std::string &frame) {
+    LoopbackBroker broker(LoopbackBroker::discard);
+    ConnectionHandler handler("127.0.0.1", broker.port());
+    handler.setOutboundLimits(4 * 1024 * 1024, 2 * 1024 * 1024);
+    if (!connectWith(handler, useIoUring, name)) {
+        broker.abandon();
+        return;
+    }
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < frames; i++)
+        handler.queueFrameWithBackpressure(frame, '\0');
+    while (handler.getOutboundStats().queuedFrames > 0 || handler.getIoStats().framesOut < static_cast<unsigned>(frames))
+        std::this_thread::yield();
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(Clock::now() - start).count();
+    ConnectionHandler::IoStats stats = handler.getIoStats();
+    handler.close();
+    broker.finish();
+    std::cout << name << std::endl;
+    report("write", frames, stats.bytesOut, seconds, stats.writeCalls);
+}
+
+static void readBench(bool useIoUring, const char *name, int frames, const std::string &frame) {
+    std::string delimited = frame + '\0';
+    LoopbackBroker broker([&delimited, frames](LoopbackBroker::tcp::socket &socket) {
+        writeFrames(socket, delimited, frames);
+    });
+    ConnectionHandler handler("127.0.0.1", broker.port());
+    if (!connectWith(handler, useIoUring, name)) {
+        broker.abandon();
+        return;
+    }
+    FrameView view;
+    int received = 0;
+    Clock::time_point start = Clock::now();
+    while (received < frames && handler.getFrameView(view))
+        received++;
+    double seconds = std::chrono::duration_cast<std::chrono::duration<double>>(Clock::now() - start).count();
+    ConnectionHandler::IoStats stats = handler.getIoStats();
+    handler.close();
+    broker.finish();
+    report("read ", received, stats.bytesIn, seconds, stats.readCalls);
+}
+
+int main(int argc, char *argv[]) {
+    int frames = argc > 1 ? std::atoi(argv[1]) : 200000;
+    size_t bodySize = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 512;
+    std::string body(bodySize, 'x');
+    std::string send = "SEND\ndestination:/bench\ncontent-length:" + std::to_string(body.size()) + "\n\n" + body;
+    std::string message = "MESSAGE\nsubscription:0\nmessage-id:1\ndestination:/bench\ncontent-length:" +
+                          std::to_string(body.size()) + "\n\n" + body;
+    std::cout << frames << " frames, " << bodySize << " byte bodies" << std::endl;
+
+    writeBench(false, "Boost sockets", frames, send);
+    readBench(false, "Boost sockets", frames, message);
+    writeBench(true, "io_uring", frames, send);
+    readBench(true, "io_uring", frames, message);
+    return 0;
+}
@@ -2,32 +2,296 @@
 
 #include <string>
 #include <iostream>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <future>
 #include <boost/asio.hpp>
 #include "StompProtocol.h"
+#include "SocketProfile.h"
+#include "UringTransport.h"
+#include "FrameView.h"
+#include <memory>
 #include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
 
 using boost::asio::ip::tcp;
 
+// Blocking: a reader thread calls getStompFrame in a loop and a writer thread drains the queue.
+// Async: reads and writes are completion handlers run by whoever calls io_service::run.
+enum class IoMode { Blocking, Async };
+
 class ConnectionHandler {
+public:
+	// called by the writer once a queued frame was written (true) or dropped (false)
+	typedef std::function<void(bool)> SendCallback;
+	// async mode: called on the io_service thread for every received frame.
+	// The view points into the receive buffer and is only valid during the call.
+	typedef std::function<void(const FrameView &)> FrameHandler;
+	// async mode: called on the io_service thread once when the connection goes down
+	typedef std::function<void()> CloseHandler;
+
+	// I/O counters of one connection, see getIoStats. Blocked times are spent inside
+	// blocking read/write calls (blocking mode; async mode never blocks).
+	struct IoStats {
+		unsigned long long framesIn;
+		unsigned long long framesOut;
+		unsigned long long bytesIn;
+		unsigned long long bytesOut;
+		unsigned long long readCalls;       // read syscalls, empty busy-poll reads included
+		unsigned long long writeCalls;      // write syscalls
+		unsigned long long partialWrites;   // writes that sent less than asked for
+		std::chrono::microseconds readBlocked;
+		std::chrono::microseconds writeBlocked;
+		unsigned long long writeBatches;           // coalesced writes (framesOut / writeBatches = batch size)
+		std::chrono::microseconds coalesceDelay;   // time frames were held back to fill a batch
+		unsigned long long framesDropped;          // queued frames never written (write failed, connection closed)
+		IoStats() : framesIn(0), framesOut(0), bytesIn(0), bytesOut(0), readCalls(0), writeCalls(0),
+		            partialWrites(0), readBlocked(0), writeBlocked(0), writeBatches(0), coalesceDelay(0),
+		            framesDropped(0) {}
+		double bytesPerRead() const { return readCalls == 0 ? 0 : static_cast<double>(bytesIn) / readCalls; }
+		double framesPerBatch() const { return writeBatches == 0 ? 0 : static_cast<double>(framesOut) / writeBatches; }
+	};
+
+	// outcome of tryQueueFrame
+	enum class QueueResult { Queued, WouldBlock, Closed };
+
+	// outbound queue figures, to size the byte budget (see setOutboundLimits)
+	struct OutboundStats {
+		size_t queuedFrames;                           // waiting for the writer right now
+		size_t queuedBytes;
+		size_t peakBytes;                              // highest queuedBytes seen
+		size_t blockedCount;                           // producer waits and WouldBlock answers
+		std::chrono::steady_clock::duration blockedTime; // time producers spent waiting for space
+		OutboundStats() : queuedFrames(0), queuedBytes(0), peakBytes(0), blockedCount(0), blockedTime(0) {}
+	};
+
 private:
+	// a frame waiting in the outbound queue, already terminated by its delimiter
+	struct OutboundFrame {
+		std::string data;
+		SendCallback onSent;
+		bool last;   // queueFinalFrame: the writer stops after this one
+		OutboundFrame() : data(), onSent(), last(false) {}
+	};
+
 	const std::string host_;
-	const short port_;
+	const unsigned short port_;
 	boost::asio::io_service io_service_;   // Provides core I/O functionality
-	tcp::socket socket_;
+	boost::asio::io_service &ioService_;   // the service the socket runs on: io_service_ or a shared one
+	// generic stream socket: carries either a TCP or a Unix-domain connection
+	boost::asio::generic::stream_protocol::socket socket_;
+	const IoMode mode_;
+	SocketProfile profile_;
 
 	StompProtocol protocol_;
+	StompProtocol *sharedProtocol_;   // set when the protocol state is shared by a ConnectionPool
+	int connectionId_;                // index in the pool, 0 for a single connection
     
     std::mutex socketMutex_;
-    bool connected_;
+    std::atomic<bool> connected_;
+
+    // outbound queue, two lanes drained in order by the writer thread. At every frame
+    // boundary the control lane (queueFrame: CONNECT, SUBSCRIBE, heart-beats ...) goes first,
+    // so it never waits behind bulk frames (queueFrameWithBackpressure / tryQueueFrame).
+    // DISCONNECT is the exception: queueFinalFrame puts it behind the bulk lane and seals
+    // the queue, so it never overtakes a SEND the broker would then drop.
+    std::deque<OutboundFrame> control_;
+    std::deque<OutboundFrame> outbound_;
+    bool sealed_;   // a final frame is queued: nothing else is accepted until the next connect
+    std::mutex outboundMutex_;
+    std::condition_variable outboundCv_;
+    std::thread writerThread_;
+
+    // outbound byte budget (guarded by outboundMutex_): once outboundBytes_ reaches highWatermark_
+    // the queue is throttled, and producers that respect backpressure wait on spaceCv_ until it
+    // drained to lowWatermark_. highWatermark_ 0 = unbounded. Control frames are never held back.
+    size_t outboundBytes_;
+    size_t highWatermark_;
+    size_t lowWatermark_;
+    bool throttled_;
+    std::condition_variable spaceCv_;
+    OutboundStats outboundStats_;
+
+    enum class Backpressure { Ignore, Fail, Wait, Final };
+    // builds the delimited frame and appends it to its lane under the given policy
+    // (Ignore: control lane, otherwise bulk lane; Final also seals the queue)
+    // (the frame is taken by value: a caller that moves it in hands over its buffer, which
+    // writeExact already sized for the delimiter)
+    QueueResult enqueueFrame(std::string frame, char delimiter, SendCallback onSent, Backpressure policy);
+    // bookkeeping for frames entering / leaving the queue, outboundMutex_ held
+    void chargeOutboundLocked(size_t bytes);
+    void releaseOutboundLocked(size_t bytes);
+
+    // STOMP heart-beating (0 = off). Times are steady_clock milliseconds.
+    // blocking mode: the writer thread doubles as the heart-beat timer.
+    // async mode: heartBeatTimer_ on the io_service.
+    std::atomic<long long> heartBeatSendMs_;
+    std::atomic<long long> heartBeatReceiveMs_;
+    std::atomic<long long> lastSendMs_;
+    std::atomic<long long> lastReceiveMs_;
+
+    // io_uring transport (blocking mode only): one ring for the reader thread with readBuffer_
+    // registered, one for the writer thread with writeStaging_ registered. nullptr = Boost sockets.
+    bool useIoUring_;
+    std::unique_ptr<UringTransport> readRing_;
+    std::unique_ptr<UringTransport> writeRing_;
+    std::vector<char> writeStaging_;
+
+    // I/O counters: bumped by the reader, writer and io_service threads, read by getIoStats
+    struct IoCounters {
+        std::atomic<unsigned long long> framesIn;
+        std::atomic<unsigned long long> framesOut;
+        std::atomic<unsigned long long> bytesIn;
+        std::atomic<unsigned long long> bytesOut;
+        std::atomic<unsigned long long> readCalls;
+        std::atomic<unsigned long long> writeCalls;
+        std::atomic<unsigned long long> partialWrites;
+        std::atomic<long long> readBlockedUs;
+        std::atomic<long long> writeBlockedUs;
+        std::atomic<unsigned long long> writeBatches;
+        std::atomic<long long> coalesceDelayUs;
+        std::atomic<unsigned long long> framesDropped;
+        IoCounters() : framesIn(0), framesOut(0), bytesIn(0), bytesOut(0), readCalls(0), writeCalls(0),
+                       partialWrites(0), readBlockedUs(0), writeBlockedUs(0), writeBatches(0), coalesceDelayUs(0),
+                       framesDropped(0) {}
+    };
+    IoCounters ioCounters_;
+
+    // write coalescing: a burst of frames is merged into one gather write of at most
+    // coalesceBytes_, waiting up to coalesceBudgetUs_ for more frames (blocking writer only)
+    long long coalesceBudgetUs_;
+    size_t coalesceBytes_;
+
+    // receive buffer: bytes in [readStart_, readEnd_) arrived from the socket
+    // but were not consumed yet (the beginning of the next frame).
+    std::vector<char> readBuffer_;
+    size_t readStart_;
+    size_t readEnd_;
+    // getFrameView: frames larger than readBuffer_ are assembled here
+    std::string frameSpill_;
+
+    // moves the unread bytes to the front of the receive buffer and appends
+    // what one read_some call returns - blocking.
+    // Returns false in case the connection is closed.
+    bool fillReadBuffer();
+
+    // fills destination with exactly 'length' received bytes, buffered ones first - blocking.
+    bool readExact(char *destination, size_t length);
+
+    // low-latency profile: spin on non-blocking reads for up to busyPollMicros.
+    // Returns true once data arrived (readEnd_ updated) or the connection failed (error set),
+    // false if the budget ran out and the caller should fall back to a blocking read.
+    bool busyPollRead(boost::system::error_code &error);
+
+    // applies profile_ to the connected socket
+    void applySocketProfile();
+
+    // true if host_ names a Unix-domain socket ("unix:/path")
+    bool isUnixSocket() const;
+
+    // TCP addresses of host_, resolved on the first connect and reused by reconnects
+    std::vector<tcp::endpoint> endpointCache_;
+
+    // fills endpointCache_ (numeric address or resolver lookup). Returns false if host_ has no address.
+    bool resolveEndpoints(boost::system::error_code &error);
+    void asyncResolveEndpoints(std::function<void(const boost::system::error_code &)> done);
+    bool cacheNumericEndpoint();
+    bool cacheResolvedEndpoints(tcp::resolver::iterator it, boost::system::error_code &error);
+
+    // happy-eyeballs connect: staggered parallel attempts to every cached endpoint,
+    // the first one to succeed becomes socket_. Returns false if all of them failed.
+    bool raceConnect(boost::system::error_code &error);
+    // the same race on 'service', 'done' is called once it is decided
+    void startConnectRace(boost::asio::io_service &service, std::function<void(const boost::system::error_code &)> done);
+    void asyncRaceEndpoints(bool cached, std::function<void(const boost::system::error_code &)> done);
+    void adoptSocket(tcp::socket &winner, const tcp::endpoint &endpoint, boost::system::error_code &error);
+
+    // connect() / asyncReconnect() helpers
+    void printConnectTarget() const;
+    void finishConnect();
+    void resetConnection();
+
+    // writer thread body: pops frames off the outbound queue and writes them to the socket.
+    void writerLoop();
+
+    // io_uring writer: copies a batch of queued frames into writeStaging_ and writes them
+    // with as few submissions as possible. Returns false if the connection failed.
+    bool uringWriteBatch(std::vector<OutboundFrame> &batch);
+    // Boost writer: the whole batch as one gather write. Returns false if the connection failed.
+    bool gatherWriteBatch(std::vector<OutboundFrame> &batch);
+    // writerLoop helper, outboundMutex_ held
+    bool takeFramesLocked(std::vector<OutboundFrame> &batch, size_t &staged, size_t limit);
+    bool uringWriteStaged(size_t length);
+
+    // sets up readRing_/writeRing_ after connect, falls back to Boost sockets on failure
+    void setupIoUring();
+
+    // what the heart-beat timer has to do now; untilNext is how long it may sleep otherwise
+    enum class HeartBeatDue { None, Send, PeerDead };
+    HeartBeatDue heartBeatDue(long long &untilNextMs) const;
+
+    // async mode state, only touched on the io_service thread
+    boost::asio::streambuf asyncReadBuffer_;
+    size_t asyncSeenBytes_;  // streambuf size at the last match, tells reads from rescans
+    FrameView::Scan asyncScan_;   // how far the match got in the frame at the front of the streambuf
+    FrameView asyncFrame_;   // parsed in place for onFrame_, reused for every frame
+    FrameHandler onFrame_;
+    CloseHandler onClose_;
+    bool closeReported_;
+    bool writeInProgress_;
+    std::vector<OutboundFrame> asyncBatch_;   // frames owned by the running async_write
+    boost::asio::steady_timer heartBeatTimer_;
+
+    // async mode: one async_read_until('\0') whose handler dispatches the frame and re-arms itself.
+    void asyncReadFrame();
+    // async mode: async_write of the front of the outbound queue, chained until the queue is empty.
+    void asyncWriteNext();
+    // async mode: marks the connection down, fails queued frames and calls onClose_ once per connection.
+    void asyncShutdown();
+    // async mode: arms heartBeatTimer_ for the next heart-beat check.
+    void asyncHeartBeat();
 
 public:
-	ConnectionHandler(std::string host, short port);
+	// host is an IP address or host name, or "unix:/path/to/socket" for a Unix-domain socket (port is ignored)
+	ConnectionHandler(std::string host, unsigned short port, IoMode mode = IoMode::Blocking);
+
+	// Async mode on an io_service owned by the caller, so one event loop can drive many connections.
+	ConnectionHandler(std::string host, unsigned short port, boost::asio::io_service &sharedService);
 
 	virtual ~ConnectionHandler();
 
+	ConnectionHandler(const ConnectionHandler &) = delete;
+	ConnectionHandler &operator=(const ConnectionHandler &) = delete;
+
+	// Socket options used by the next connect()
+	void setSocketProfile(const SocketProfile &profile) { profile_ = profile; }
+	const SocketProfile& getSocketProfile() const { return profile_; }
+
+	// Use the io_uring transport for the next connect() if the kernel supports it (blocking mode only)
+	void setUseIoUring(bool enabled) { useIoUring_ = enabled; }
+	bool isUsingIoUring() const { return readRing_ != nullptr; }
+
+	// Pin the calling thread to the profile's reader CPU (no-op if none is set)
+	// Returns false if the affinity could not be set.
+	bool pinReaderThread();
+
 	// Connect to the remote machine
 	bool connect();
 
+	// Connect again after the connection dropped (same host, profile and transport).
+	// Blocking mode: call from the reader thread. Async mode: call on the io_service thread,
+	// reading resumes with the handlers given to startAsync.
+	// Blocks until the connect is decided, see asyncReconnect for the event loop.
+	bool reconnect();
+
+	// Async mode: reconnect() without blocking the io_service thread. 'done' runs on that
+	// thread with the result; on success reading has resumed with the startAsync handlers.
+	void asyncReconnect(std::function<void(bool)> done);
+
 	// Read a fixed number of bytes from the server - blocking.
 	// Returns false in case the connection is closed before bytesToRead bytes can be read.
 	bool getBytes(char bytes[], unsigned int bytesToRead);
@@ -48,12 +312,73 @@ public:
 	// Returns false in case connection closed before null can be read.
 	bool getFrameAscii(std::string &frame, char delimiter);
 
+	// Get one STOMP frame (without its '\0'), honouring the content-length header:
+	// the body is then read as one exact-size block and may contain NULs.
+	// Returns false in case connection closed before the frame is complete.
+	bool getStompFrame(std::string &frame);
+
+	// Zero-copy variant of getStompFrame: parses the next frame in place. The views stay
+	// valid until the next get*Frame call on this connection.
+	// Returns false in case connection closed before the frame is complete.
+	bool getFrameView(FrameView &frame);
+
 	// Send a message to the remote host.
 	// Returns false in case connection is closed before all the data is sent.
 	bool sendFrameAscii(const std::string &frame, char delimiter);
 
+	// Queue a message for the writer thread and return immediately.
+	// Control lane: written before any queued bulk frame, never held back by the byte budget.
+	// onSent (optional) runs on the writer thread once the frame was sent or dropped.
+	// Returns false in case the connection is already closed.
+	// Frames are taken by value: pass an rvalue (std::move) and it is queued without a copy.
+	bool queueFrame(std::string frame, char delimiter, SendCallback onSent = SendCallback());
+
+	// Bulk producers (bulk lane): like queueFrame, but waits while the outbound queue is over its byte budget
+	// (until it drained to the low watermark). Must not be called on the io_service thread.
+	// Returns false in case the connection is closed.
+	bool queueFrameWithBackpressure(std::string frame, char delimiter, SendCallback onSent = SendCallback());
+
+	// Non-blocking variant: WouldBlock (nothing queued) while the queue is over its byte budget.
+	QueueResult tryQueueFrame(std::string frame, char delimiter, SendCallback onSent = SendCallback());
+
+	// The last frame of the session (DISCONNECT): queued behind every frame already waiting
+	// in either lane, never held back by the byte budget. Afterwards the queue refuses new
+	// frames and the writer stops (no heart-beats either) once this frame is written.
+	// Returns false in case the connection is closed or a final frame is already queued.
+	bool queueFinalFrame(std::string frame, char delimiter, SendCallback onSent = SendCallback());
+
+	// Write coalescing: frames of a burst wait up to 'budget' to share one write of at most
+	// maxBytes. A frame after an idle period is always written at once. Budget 0 = no waiting.
+	void setWriteCoalescing(std::chrono::microseconds budget, size_t maxBytes);
+
+	// Snapshot of the I/O counters (since the handler was created, reconnects included)
+	IoStats getIoStats() const;
+
+	// Byte budget of the outbound queue: throttled at highBytes, released at lowBytes (0 = unbounded)
+	void setOutboundLimits(size_t highBytes, size_t lowBytes);
+	OutboundStats getOutboundStats();
+
+	// Same as queueFrame, for callers that want to wait for the write to finish.
+	std::future<bool> queueFrameWithFuture(std::string frame, char delimiter);
+
+	// Async mode: start reading '\0' terminated frames, each one is passed to onFrame.
+	// Call after connect(); the handlers run on the thread that runs getIoService().
+	void startAsync(FrameHandler onFrame, CloseHandler onClose);
+	boost::asio::io_service& getIoService() { return ioService_; }
+
+	// Start heart-beating as negotiated in CONNECTED: send an EOL when nothing was sent for
+	// sendEveryMs, and close the connection when nothing arrived for two receive intervals.
+	// 0 disables the direction.
+	void startHeartBeat(int sendEveryMs, int expectEveryMs);
+	IoMode getMode() const { return mode_; }
+
 	// Close down the connection properly.
 	void close();
 	bool isConnected() const { return connected_; }
-    StompProtocol& getProtocol() { return protocol_; }
+    StompProtocol& getProtocol() { return sharedProtocol_ != nullptr ? *sharedProtocol_ : protocol_; }
+
+	// Pool mode: use a protocol object shared with other connections instead of our own
+	void useSharedProtocol(StompProtocol &protocol) { sharedProtocol_ = &protocol; }
+	void setConnectionId(int id) { connectionId_ = id; }
+	int getConnectionId() const { return connectionId_; }
 }; //class ConnectionHandler
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "ConnectionHandler.h"
+#include "StompProtocol.h"
+
+// N broker connections sharing one StompProtocol (subscriptions, game reports, receipts).
+// Each topic is hashed onto one connection, so a game's SUBSCRIBE, SEND and UNSUBSCRIBE
+// frames keep their order while different games are read by different threads.
+// Every connection logs in on its own, so the broker has to accept several sessions per user.
+// In async mode all connections share one io_service, run by a single thread (see getIoService).
+class ConnectionPool {
+public:
+    ConnectionPool(const std::string &host, unsigned short port, size_t size, IoMode mode);
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool &) = delete;
+    ConnectionPool &operator=(const ConnectionPool &) = delete;
+
+    size_t size() const { return connections_.size(); }
+    ConnectionHandler& at(size_t index) { return *connections_[index]; }
+
+    // the connection that carries every frame of 'topic'
+    ConnectionHandler& forTopic(const std::string &topic);
+
+    StompProtocol& getProtocol() { return protocol_; }
+
+    // async mode: the event loop of every connection; one thread calling run() drives the pool
+    boost::asio::io_service& getIoService() { return ioService_; }
+
+    // connects every connection; on failure the ones already open are closed again
+    bool connect();
+
+    // closes every connection
+    void close();
+
+    // true while at least one connection is up
+    bool isConnected() const;
+
+    // I/O and outbound queue figures of every connection, one block per connection
+    void printStats(std::ostream &out);
+
+    // appends printStats to 'path' every intervalMs until close() (and once more then)
+    void startStatsDump(const std::string &path, int intervalMs);
+
+private:
+    StompProtocol protocol_;   // declared first: the connections refer to it until they are gone
+    boost::asio::io_service ioService_;   // async mode: owns the sockets and timers of the connections
+    std::vector<std::unique_ptr<ConnectionHandler>> connections_;
+
+    // periodic stats dump
+    std::thread dumpThread_;
+    std::mutex dumpMutex_;
+    std::condition_variable dumpCv_;
+    bool dumpStop_;
+
+    void stopStatsDump();
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+// zlib deflate for STOMP bodies marked "content-encoding:deflate".
+// The output is binary (may contain NULs), so it is always sent with a content-length.
+class DeflateCodec {
+public:
+    // level 6 (zlib's default). On report bodies of a few hundred bytes it already reaches the
+    // ratio of level 9, and every level costs the same: zlib's per-call setup dominates
+    // (bench/CompressionBench.cpp)
+    static const int DEFAULT_LEVEL = 6;
+
+    // compresses 'in' into 'out' at 'level' (1 fastest .. 9 smallest).
+    // Returns false if zlib failed (out is then undefined).
+    static bool compress(const std::string &in, std::string &out, int level = DEFAULT_LEVEL);
+
+    // inflates [data, data + length) into 'out', at most 'maxOutput' bytes of it.
+    // Returns false if the data is not a valid deflate stream or inflates to more than that
+    // (a few KB of deflate can expand to gigabytes).
+    static bool decompress(const char *data, size_t length, std::string &out, size_t maxOutput);
+};
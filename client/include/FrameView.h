@@ -0,0 +1,132 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <ostream>
+
+// Non-owning view of a run of characters (C++11 has no std::string_view).
+// Only valid while the memory it points into is.
+struct StringView {
+    const char *data;
+    size_t size;
+
+    static const size_t npos = static_cast<size_t>(-1);
+
+    StringView() : data(""), size(0) {}
+    StringView(const char *begin, size_t length) : data(begin), size(length) {}
+
+    bool empty() const { return size == 0; }
+    char back() const { return data[size - 1]; }
+
+    bool operator==(const char *literal) const {
+        size_t length = std::strlen(literal);
+        return length == size && std::memcmp(data, literal, length) == 0;
+    }
+    bool operator!=(const char *literal) const { return !(*this == literal); }
+
+    bool startsWith(const char *prefix) const {
+        size_t length = std::strlen(prefix);
+        return length <= size && std::memcmp(data, prefix, length) == 0;
+    }
+
+    // same semantics as std::string::substr / find
+    StringView substr(size_t pos, size_t length = npos) const {
+        if (pos > size)
+            pos = size;
+        return StringView(data + pos, length < size - pos ? length : size - pos);
+    }
+    size_t find(char c, size_t from = 0) const {
+        if (from >= size)
+            return npos;
+        const char *hit = static_cast<const char *>(std::memchr(data + from, c, size - from));
+        return hit == nullptr ? npos : hit - data;
+    }
+
+    // copies the characters out, for data that has to outlive the receive buffer
+    std::string str() const { return std::string(data, size); }
+};
+
+inline std::ostream &operator<<(std::ostream &out, const StringView &view) {
+    return out.write(view.data, view.size);
+}
+
+// A received STOMP frame parsed in place: command, headers and body point into the
+// connection's receive buffer, nothing is copied. The views are only valid until the
+// connection reads the next frame, so handlers copy (str()) whatever they keep.
+struct FrameView {
+    // server frame commands, classified once while parsing so handlers switch on an enum
+    enum Command { UnknownCommand, Connected, Message, Receipt, Error };
+
+    // headers the client looks at. parse() records where the first one of each name is,
+    // so header(ContentLength) is an array lookup instead of a scan over all headers.
+    enum Header {
+        ContentLength, ContentEncoding, ContentType, ReceiptId, HeartBeat, AcceptEncoding,
+        Version, Subscription, MessageId, Destination, KNOWN_HEADERS
+    };
+
+    StringView raw;       // the whole frame without its '\0' (heart-beat EOLs skipped)
+    StringView command;
+    Command type;
+    std::vector<std::pair<StringView, StringView>> headers;   // in arrival order, '\r' stripped
+    StringView body;
+    size_t bodyOffset;    // where the body starts in raw (raw.size if there is no body)
+
+    FrameView() : raw(), command(), type(UnknownCommand), headers(), body(), bodyOffset(0), known() {}
+
+    // value of the first header with this name (STOMP: the first one wins), empty if missing
+    StringView header(Header name) const;
+    bool hasHeader(Header name) const { return known[name] != 0; }
+    // same for headers outside the table, found by scanning
+    StringView header(const char *name) const;
+    bool hasHeader(const char *name) const;
+
+    // parses one frame (without its '\0') living in [data, data + size) in a single pass:
+    // command, header table and body offset are all filled while walking the lines once.
+    // Reuses the header vector, so a reader that keeps one FrameView does not allocate.
+    // Returns false if there is no command (only heart-beat EOLs).
+    bool parse(const char *data, size_t size);
+
+    static Command classifyCommand(const StringView &command);
+    static Header classifyHeader(const StringView &name);   // KNOWN_HEADERS if not in the table
+
+    // ---- framing helpers, shared by the blocking and the async receive path ----
+
+    static const size_t NO_LENGTH = static_cast<size_t>(-1);
+
+    // largest frame the client accepts (headers and body). content-length comes from the peer,
+    // anything above this is a protocol error instead of an allocation of that size.
+    static const size_t MAX_FRAME_SIZE = 16 * 1024 * 1024;
+    // completeFrameLength: the frame is (or announces to be) larger than MAX_FRAME_SIZE
+    static const size_t FRAME_TOO_LARGE = NO_LENGTH;
+
+    // value of the first content-length header in a header block,
+    // NO_LENGTH if there is none or it is not a number. Values above MAX_FRAME_SIZE
+    // come back as MAX_FRAME_SIZE + 1 (no overflow on absurdly long numbers).
+    static size_t findContentLength(const char *headers, size_t length);
+
+    // length of the first complete frame in [data, data + size) including its '\0', 0 if more
+    // bytes are needed. Heart-beat EOLs in front stay part of it (parse skips them).
+    // With content-length the body is skipped without looking at it, so it may contain NULs.
+    // FRAME_TOO_LARGE once the frame cannot fit into MAX_FRAME_SIZE: the connection is unusable.
+    static size_t completeFrameLength(const char *data, size_t size);
+
+    // how far completeFrameLength got in a buffer that only grows at its end between calls
+    // (the async reader's streambuf): the next call resumes there instead of rescanning the
+    // headers and body from the start. reset() once the frame is consumed.
+    struct Scan {
+        size_t start;          // first byte after the heart-beat EOLs in front of the frame
+        size_t scanned;        // bytes looked at so far
+        size_t lineStart;      // start of the header line being scanned
+        size_t headerEnd;      // just past the empty line ("\n" or "\r\n"), relative to start; NO_LENGTH until then
+        size_t contentLength;  // valid once headerEnd is, NO_LENGTH without the header
+
+        Scan() : start(0), scanned(0), lineStart(0), headerEnd(NO_LENGTH), contentLength(NO_LENGTH) {}
+        void reset() { *this = Scan(); }
+    };
+    static size_t completeFrameLength(const char *data, size_t size, Scan &scan);
+
+private:
+    size_t known[KNOWN_HEADERS];   // 1 + index into headers, 0 if the header is missing
+};
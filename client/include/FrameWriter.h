@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+
+// Serializes a frame into a string that is allocated once at its final size.
+// A FrameWriter either only counts bytes (out == nullptr) or appends them; writeExact runs
+// the same build function through both, so the count is exact and nothing is ever regrown
+// (checked by test/FrameAllocationTest.cpp).
+// Numbers are formatted in place, lines are appended piece by piece: no temporary strings.
+class FrameWriter {
+public:
+    explicit FrameWriter(std::string *out) : out_(out), size_(0) {}
+    FrameWriter(const FrameWriter &) = delete;
+    FrameWriter &operator=(const FrameWriter &) = delete;
+
+    FrameWriter &append(const char *text, size_t length) {
+        if (out_ != nullptr)
+            out_->append(text, length);
+        size_ += length;
+        return *this;
+    }
+    FrameWriter &append(const char *text) { return append(text, std::strlen(text)); }
+    FrameWriter &append(const std::string &text) { return append(text.data(), text.size()); }
+    FrameWriter &append(char c) { return append(&c, 1); }
+    FrameWriter &appendNumber(long long value);
+
+    // "prefix" + value + '\n': a header ("login:") or a body line ("team a: ")
+    FrameWriter &line(const char *prefix, const std::string &value) {
+        return append(prefix).append(value).append('\n');
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    std::string *out_;
+    size_t size_;
+};
+
+// build(FrameWriter&) must write the same bytes every time it is called.
+// One byte more is reserved for the delimiter the outbound queue appends, so the frame can
+// be moved into the queue as it is.
+template <typename Build>
+std::string writeExact(const Build &build) {
+    FrameWriter counter(nullptr);
+    build(counter);
+
+    std::string frame;
+    frame.reserve(counter.size() + 1);
+    FrameWriter writer(&frame);
+    build(writer);
+    return frame;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "FrameView.h"
+
+// FNV-1a over a key, usable as a case label:
+//
+//     switch (keyHash(view)) {
+//     case keyHash("content-length"): ...
+//
+// Two keys of one switch hashing alike would be a duplicate case and fail to compile, so
+// every switch is a perfect hash over its keys, checked by the compiler. Input that is not
+// one of the keys can still land on a case, so each case confirms with one compare.
+// Hashing reads the whole key: for a handful of candidates that mostly differ in their first
+// byte a chain of compares is faster (bench/KeyDispatchBench.cpp has the numbers).
+
+namespace keyhash_detail {
+const uint32_t OFFSET_BASIS = 2166136261u;
+const uint32_t PRIME = 16777619u;
+
+// C++11 constexpr: a single return, so the loop is a recursion
+constexpr uint32_t step(const char *key, size_t length, uint32_t hash) {
+    return length == 0 ? hash
+        : step(key + 1, length - 1, (hash ^ static_cast<unsigned char>(*key)) * PRIME);
+}
+} // namespace keyhash_detail
+
+// for string literals, evaluated at compile time
+template <size_t N>
+constexpr uint32_t keyHash(const char (&literal)[N]) {
+    return keyhash_detail::step(literal, N - 1, keyhash_detail::OFFSET_BASIS);
+}
+
+// for received text, same result as the literal version
+inline uint32_t keyHash(const StringView &key) {
+    uint32_t hash = keyhash_detail::OFFSET_BASIS;
+    for (size_t i = 0; i < key.size; i++)
+        hash = (hash ^ static_cast<unsigned char>(key.data[i])) * keyhash_detail::PRIME;
+    return hash;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// Flow control for pipelined publishing: at most 'capacity' frames may wait for their
+// RECEIPT at the same time. The publisher blocks in acquire() when the window is full,
+// the reader thread frees a slot in acknowledge() when the matching RECEIPT arrives.
+class ReceiptWindow {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // totals for one publishing run, filled as receipts come back
+    struct Stats {
+        size_t sent;
+        size_t acked;
+        Clock::duration elapsed;        // first acquire() until the last receipt (or abort)
+        Clock::duration totalLatency;   // sum of send -> receipt times
+        Clock::duration maxLatency;
+        Stats() : sent(0), acked(0), elapsed(), totalLatency(), maxLatency() {}
+    };
+
+    explicit ReceiptWindow(size_t capacity);
+
+    // blocks until there is room for one more unacknowledged frame.
+    // Returns false if the window was aborted (connection lost).
+    bool acquire();
+
+    // records that the frame carrying 'receiptId' is on its way; call before queueing it.
+    void sent(const std::string &receiptId);
+
+    // the RECEIPT for 'receiptId' arrived. Returns false if the id is not ours.
+    bool acknowledge(const std::string &receiptId);
+
+    // blocks until every sent frame is acknowledged.
+    // Returns false if the window was aborted before that.
+    bool waitAll();
+
+    // wakes up all waiters, nothing more will be acknowledged.
+    void abort();
+
+    Stats getStats();
+
+private:
+    const size_t capacity_;
+    std::map<std::string, Clock::time_point> pending_;   // receipt id -> send time
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    bool aborted_;
+    bool started_;
+    Clock::time_point start_;
+    Clock::time_point end_;
+    Stats stats_;
+};
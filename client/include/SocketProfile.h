@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+
+// Socket tuning applied by ConnectionHandler::connect.
+// low-latency: Nagle off, small buffers, optional busy-poll reads and a pinned reader thread.
+// throughput: Nagle on and large kernel buffers so the kernel can batch segments.
+struct SocketProfile {
+    std::string name;
+    bool noDelay;             // TCP_NODELAY
+    int receiveBufferSize;    // SO_RCVBUF in bytes, 0 = kernel default
+    int sendBufferSize;       // SO_SNDBUF in bytes, 0 = kernel default
+    int busyPollMicros;       // spin on non-blocking reads this long before blocking, 0 = never spin
+    int readerCpu;            // CPU the reader thread is pinned to, -1 = not pinned
+
+    SocketProfile()
+        : name("default"), noDelay(false), receiveBufferSize(0), sendBufferSize(0),
+          busyPollMicros(0), readerCpu(-1) {}
+
+    static SocketProfile lowLatency() {
+        SocketProfile profile;
+        profile.name = "low-latency";
+        profile.noDelay = true;
+        profile.receiveBufferSize = 64 * 1024;
+        profile.sendBufferSize = 64 * 1024;
+        return profile;
+    }
+
+    static SocketProfile throughput() {
+        SocketProfile profile;
+        profile.name = "throughput";
+        profile.noDelay = false;
+        profile.receiveBufferSize = 4 * 1024 * 1024;
+        profile.sendBufferSize = 4 * 1024 * 1024;
+        return profile;
+    }
+
+    // "default", "low-latency" or "throughput"; returns false for anything else
+    static bool fromName(const std::string &profileName, SocketProfile &profile) {
+        if (profileName == "default")
+            profile = SocketProfile();
+        else if (profileName == "low-latency")
+            profile = lowLatency();
+        else if (profileName == "throughput")
+            profile = throughput();
+        else
+            return false;
+        return true;
+    }
+};
@@ -4,59 +4,112 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <set>
 #include <mutex>
 #include "event.h"
+#include "ReceiptWindow.h"
+#include "FrameView.h"
 #include <condition_variable>
+#include <atomic>
 using namespace std;
 
 class StompProtocol {
 private:
+    // credentials of the last login, guarded by mtx (a reconnecting reader thread reads them)
     string username;
     string password;
     int receiptIdCounter;
     int subscriptionIdCounter;
-    bool loggedIn;
+    // heart-beat we offer in CONNECT (ms): how often we can send, how often we want to receive
+    int heartBeatSendMs;
+    int heartBeatReceiveMs;
+    // body compression: SEND bodies of at least compressThreshold bytes are deflated (0 = off),
+    // once the broker's CONNECTED confirmed it passes "content-encoding:deflate" through
+    size_t compressThreshold;
+    std::atomic<bool> compressionAccepted;
+    // connections that reconnected and wait for CONNECTED to replay their subscriptions
+    set<int> resubscribePending;
+    std::atomic<bool> loggedIn;
+    // pool connection that got an ERROR frame (-1: none); the whole session is unusable then
+    std::atomic<int> failedConnection;
     mutex mtx;
     
     // Maps subscription ID to topic
     map<string, string> subscriptions;
+    // Maps subscription ID to the pool connection it was made on
+    map<string, int> subscriptionConnections;
     
 
     // Map: user -> game -> events
     map<string, map<string, names_and_events>> gameReports;
     
-    string generateReceiptId();
     string generateSubscriptionId();
+
+    // CONNECT with the given credentials (the members are not touched, see buildReconnectFrame)
+    string writeConnectFrame(const string& user, const string& pass) const;
     
 
 
     // Logout-related fields
     std::mutex logoutMutex;
     std::condition_variable logoutCv;
-    bool isLogoutComplete = false;      //flag to indicate logout completion 
-    std::string expectedReceiptId = ""; // to track expected receipt ID for logout
+    // logout receipts still missing -> connection their DISCONNECT went out on
+    std::map<std::string, int> expectedReceiptIds;
+    // connections with a session (CONNECTED seen, not lost since), guarded by logoutMutex
+    std::set<int> liveConnections;
+
+public:
+    // what compression saved so far (frames are built on the main thread only)
+    struct CompressionStats {
+        size_t bodies;             // bodies sent deflated
+        size_t rawBytes;           // their size before ...
+        size_t compressedBytes;    // ... and after compression
+        double deflateMs;          // time spent in zlib
+        CompressionStats() : bodies(0), rawBytes(0), compressedBytes(0), deflateMs(0) {}
+    };
+
+private:
+    CompressionStats compressionStats;
+
+    // receipt window of the report currently being published (nullptr if none)
+    // and the connection its SEND frames go out on
+    std::mutex windowMutex;
+    ReceiptWindow* reportWindow;
+    int reportConnection;
 
 
 public:
     StompProtocol();
+
+    // one protocol state per session: not copyable (mutexes, the registered report window)
+    StompProtocol(const StompProtocol&) = delete;
+    StompProtocol& operator=(const StompProtocol&) = delete;
+
+    string generateReceiptId();
     
     // Frame builders
     string buildConnectFrame(const string& host, 
                                   const string& user, 
                                   const string& pass);
     
-    string buildSubscribeFrame(const string& topic);
+    // connectionId: pool connection the frame is sent on (restored there after a reconnect)
+    string buildSubscribeFrame(const string& topic, int connectionId = 0);
     
     string buildUnsubscribeFrame(const string& subscriptionId);
     
+   // receiptId: if not empty, a receipt header is added so the broker acknowledges the SEND
    string buildSendFrame(const string& topic, 
                         const Event& event, 
-                        const string& user,  const string& filename);
+                        const string& user,  const string& filename,
+                        const string& receiptId = "");
     
-    string buildDisconnectFrame();
+    // in pool mode one DISCONNECT per connection; waitForLogout waits for all receipts.
+    // Empty if that connection has no session (never logged in or already lost): nothing to send
+    string buildDisconnectFrame(int connectionId = 0);
     
-    // Frame handlers
-    void handleMessageFrame(const string& frame);
+    // Frame handlers: the frame is a view into the receive buffer,
+    // only the parsed event fields are copied out of it
+    void handleMessageFrame(const FrameView& frame);
     
     // Game data management
     void saveGameEvent(const string& user, 
@@ -67,18 +120,60 @@ public:
                         const string& user, 
                         const string& outputFile);
     
+    // Reconnect: CONNECT with the credentials of the last login; the next CONNECTED
+    // then has to be followed by the frames of buildResubscribeFrames()
+    string buildReconnectFrame(int connectionId = 0);
+
+    // after a reconnect: one SUBSCRIBE (same id, same topic) per active subscription of
+    // that connection, empty if no reconnect is in progress there
+    vector<string> buildResubscribeFrames(int connectionId = 0);
+
+    // Heart-beating: values offered in the next CONNECT (0 = none)
+    void setHeartBeat(int sendEveryMs, int receiveEveryMs);
+
+    // takes the broker's heart-beat header of a CONNECTED frame and computes the
+    // negotiated intervals (0 = that direction is off)
+    void negotiateHeartBeat(const FrameView& connectedFrame, int& sendEveryMs, int& expectEveryMs) const;
+
+    // Compression: deflate SEND bodies from this size on (0 = off). CONNECT then offers
+    // "accept-encoding:deflate" and nothing is compressed before the broker confirmed it.
+    void setCompression(size_t thresholdBytes) { compressThreshold = thresholdBytes; }
+    // reads the broker's accept-encoding header from a CONNECTED frame
+    void negotiateCompression(const FrameView& connectedFrame);
+    CompressionStats getCompressionStats() const { return compressionStats; }
+
     // State
     bool isLoggedIn() const { return loggedIn; }
     void setLoggedIn(bool status) { loggedIn = status; }
 
+    // ERROR frame on a connection: the session is failed as a whole (in pool mode the topics
+    // hashed onto that connection are gone), the user has to log in again
+    void sessionFailed(int connectionId) { failedConnection = connectionId; }
+    bool hasSessionFailed() const { return failedConnection >= 0; }
+    int getFailedConnection() const { return failedConnection; }
+
     string getSubscriptionIdByTopic(const string& topic);
-    string getCurrentUsername() const { return username; }
+    string getCurrentUsername();
 
-    //wait for logout to complete
+    //wait for logout to complete: every DISCONNECT answered or its connection lost
     void waitForLogout();
 
    //process logout receipt
     bool processLogoutReceipt(const std::string& receiptId);
+
+    // report publishing: receipts of SEND frames are routed to this window. Only losing
+    // connectionId, the connection that carries the SENDs, aborts it.
+    void setReportWindow(ReceiptWindow* window, int connectionId = 0);
+
+    // any RECEIPT frame: logout receipt or an acknowledged SEND
+    bool processReceipt(const std::string& receiptId);
+
+    // CONNECTED on that connection: it has a session a DISCONNECT can end
+    void connectionEstablished(int connectionId = 0);
+
+    // the connection went down: wake up anyone waiting for its receipts (its logout receipt
+    // and, if it carries the report, the report's receipts will never come)
+    void connectionLost(int connectionId = 0);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+
+// Pacing for report publishing: tokens are added at 'rate' per second up to 'burst', every
+// frame takes one. acquire() sleeps until the next token is due (sleep_until on the
+// steady clock, no spinning). Used by the publishing thread only, so it is not locked.
+class TokenBucket {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // totals for one publishing run
+    struct Stats {
+        size_t granted;                 // tokens handed out
+        size_t delayed;                 // acquire() calls that had to sleep
+        Clock::duration elapsed;        // first until last acquire()
+        Clock::duration totalLateness;  // sum over delayed calls of (wake-up - due time)
+        Clock::duration maxLateness;
+        Stats() : granted(0), delayed(0), elapsed(), totalLateness(), maxLateness() {}
+    };
+
+    // the bucket starts full, so the first 'burst' frames go out at once
+    TokenBucket(double ratePerSecond, size_t burst);
+
+    // blocks until a token is available and takes it
+    void acquire();
+
+    Stats getStats() const { return stats_; }
+    double getRate() const { return rate_; }
+    size_t getBurst() const { return burst_; }
+
+private:
+    const double rate_;
+    const size_t burst_;
+    double tokens_;
+    Clock::time_point last_;    // last refill
+    Clock::time_point start_;
+    bool started_;
+    Stats stats_;
+
+    // adds the tokens earned since last_
+    void refill(Clock::time_point now);
+};
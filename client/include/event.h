@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <cstdint>
 #include <iostream>
 #include <map>
 #include <vector>
@@ -9,24 +10,57 @@ class Event
 {
 private:
     // name of team a
-    std::string team_a_name;
+    mutable std::string team_a_name;
     // name of team b
-    std::string team_b_name;
+    mutable std::string team_b_name;
     // name of the event
-    std::string name;
+    mutable std::string name;
     // time of the event in seconds
-    int time;
+    mutable int time;
     // map of all the general game updates
-    std::map<std::string, std::string> game_updates;
+    mutable std::map<std::string, std::string> game_updates;
     // map of all team a updates the second type can be a string bool or int
-    std::map<std::string, std::string> team_a_updates;
+    mutable std::map<std::string, std::string> team_a_updates;
     // map of all team b updates
-    std::map<std::string, std::string> team_b_updates;
+    mutable std::map<std::string, std::string> team_b_updates;
     // description of the event
-    std::string description;
+    mutable std::string description;
+
+    // Events received as a MESSAGE (Event(frame_body)) keep the body and an index of where
+    // its parts are, and only build the strings and maps above when a getter asks for them.
+    struct Span
+    {
+        uint32_t begin;
+        uint32_t length;
+    };
+    enum Part
+    {
+        TEAM_A = 1, TEAM_B = 2, NAME = 4, TIME = 8, GAME_UPDATES = 16, TEAM_A_UPDATES = 32,
+        TEAM_B_UPDATES = 64, DESCRIPTION = 128, USER = 256, ALL_PARTS = 511
+    };
+    // one "key: value" line inside a section of the body
+    struct UpdateLine
+    {
+        Span key;
+        Span value;
+        uint8_t section; // GAME_UPDATES, TEAM_A_UPDATES or TEAM_B_UPDATES
+    };
+    std::string body;
+    Span user_span, team_a_span, team_b_span, name_span, time_span, description_span;
+    std::vector<UpdateLine> update_lines;
+    // parts already decoded into the members above (all of them for the other constructors)
+    mutable unsigned decoded;
+    // reporter of a received event, from the "user" line
+    mutable std::string user;
+
+    void index_body();
+    const std::string &decode_string(Part part, const Span &span, std::string &target) const;
+    const std::map<std::string, std::string> &decode_updates(Part part, std::map<std::string, std::string> &target) const;
 
 public:
     Event(std::string name, std::string team_a_name, std::string team_b_name, int time, std::map<std::string, std::string> game_updates, std::map<std::string, std::string> team_a_updates, std::map<std::string, std::string> team_b_updates, std::string discription);
+    // indexes a MESSAGE body ("user: ...", "team a: ...", sections, "description:"),
+    // the fields are decoded on first access
     Event(const std::string & frame_body);
     virtual ~Event();
     const std::string &get_team_a_name() const;
@@ -37,6 +71,8 @@ public:
     const std::map<std::string, std::string> &get_team_a_updates() const;
     const std::map<std::string, std::string> &get_team_b_updates() const;
     const std::string &get_discription() const;
+    // the "user" line of a received event, empty for events read from a file
+    const std::string &get_user() const;
 };
 
 // an object that holds the names of the teams and a vector of events, to be returned by the parseEventsFile function
@@ -1,4 +1,15 @@
 #include "../include/ConnectionHandler.h"
+#include <cstring>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cerrno>
+#include <sys/socket.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 using boost::asio::ip::tcp;
 
@@ -8,32 +19,124 @@ using std::cerr;
 using std::endl;
 using std::string;
 
+// size of a single read from the socket, large enough to hold several MESSAGE frames.
+static const size_t READ_BUFFER_SIZE = 64 * 1024;
+// the async streambuf holds at most one maximal frame plus a read's worth of the next one
+static const size_t ASYNC_READ_BUFFER_MAX = FrameView::MAX_FRAME_SIZE + READ_BUFFER_SIZE;
+
+// write coalescing defaults: latency budget of a burst, and the most bytes one write may carry.
+static const long long DEFAULT_COALESCE_BUDGET_US = 200;
+static const size_t DEFAULT_COALESCE_BYTES = 64 * 1024;
+
+// happy eyeballs: head start of each connection attempt before the next address is tried.
+static const std::chrono::milliseconds CONNECT_ATTEMPT_DELAY(250);
+
+// current steady_clock time in milliseconds, for the heart-beat bookkeeping.
+static long long nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// steady_clock microseconds, for the time spent blocked in I/O calls.
+static long long nowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// completion condition for asio::read/write and async_write that counts the syscalls the
+// operation is made of. asio calls it before the first read_some/write_some (nothing
+// transferred, no error) and after every one that did not finish the transfer, so every
+// call it sees was a short one (or failed); the caller adds the last one on success.
+namespace {
+struct CountingTransfer {
+    std::atomic<unsigned long long> *calls;
+    std::atomic<unsigned long long> *partials;   // short transfers that needed another call, may be nullptr
+    size_t total;
+    size_t operator()(const boost::system::error_code &error, size_t transferred) const {
+        if (transferred > 0 || error) {
+            (*calls)++;
+            if (partials != nullptr && !error && transferred < total)
+                (*partials)++;
+        }
+        return error ? 0 : total - transferred;
+    }
+};
+}
+
+// host prefix selecting a Unix-domain socket instead of TCP.
+static const std::string UNIX_PREFIX = "unix:";
+
+// size of the registered buffer the io_uring writer packs queued frames into.
+static const size_t WRITE_STAGING_SIZE = 256 * 1024;
+
 // constructor: initializes the 'io_service' (the engine) and the 'socket' (the connection object).
-ConnectionHandler::ConnectionHandler(string host, short port) 
-    : host_(host), port_(port), io_service_(), socket_(io_service_), connected_(false) {}
+ConnectionHandler::ConnectionHandler(string host, unsigned short port, IoMode mode) 
+    : host_(host), port_(port), io_service_(), ioService_(io_service_), socket_(io_service_), mode_(mode),
+      profile_(), protocol_(), sharedProtocol_(nullptr), connectionId_(0), socketMutex_(), connected_(false), control_(), outbound_(), sealed_(false), outboundMutex_(), outboundCv_(),
+      writerThread_(), outboundBytes_(0), highWatermark_(0), lowWatermark_(0), throttled_(false), spaceCv_(), outboundStats_(),
+      heartBeatSendMs_(0), heartBeatReceiveMs_(0), lastSendMs_(0), lastReceiveMs_(0),
+      useIoUring_(false), readRing_(), writeRing_(), writeStaging_(),
+      ioCounters_(), coalesceBudgetUs_(DEFAULT_COALESCE_BUDGET_US), coalesceBytes_(DEFAULT_COALESCE_BYTES),
+      readBuffer_(READ_BUFFER_SIZE), readStart_(0), readEnd_(0), frameSpill_(),
+      endpointCache_(), asyncReadBuffer_(ASYNC_READ_BUFFER_MAX), asyncSeenBytes_(0), asyncScan_(), asyncFrame_(), onFrame_(), onClose_(), closeReported_(false), writeInProgress_(false), asyncBatch_(), heartBeatTimer_(io_service_) {}
+
+// constructor for a connection that shares an event loop with other connections (always async).
+ConnectionHandler::ConnectionHandler(string host, unsigned short port, boost::asio::io_service &sharedService)
+    : host_(host), port_(port), io_service_(), ioService_(sharedService), socket_(sharedService),
+      mode_(IoMode::Async), profile_(), protocol_(), sharedProtocol_(nullptr), connectionId_(0), socketMutex_(), connected_(false), control_(), outbound_(), sealed_(false), outboundMutex_(),
+      outboundCv_(), writerThread_(), outboundBytes_(0), highWatermark_(0), lowWatermark_(0), throttled_(false),
+      spaceCv_(), outboundStats_(), heartBeatSendMs_(0), heartBeatReceiveMs_(0), lastSendMs_(0),
+      lastReceiveMs_(0), useIoUring_(false), readRing_(), writeRing_(), writeStaging_(),
+      ioCounters_(), coalesceBudgetUs_(DEFAULT_COALESCE_BUDGET_US), coalesceBytes_(DEFAULT_COALESCE_BYTES),
+      readBuffer_(), readStart_(0), readEnd_(0), frameSpill_(),
+      endpointCache_(), asyncReadBuffer_(ASYNC_READ_BUFFER_MAX), asyncSeenBytes_(0), asyncScan_(), asyncFrame_(), onFrame_(), onClose_(), closeReported_(false), writeInProgress_(false), asyncBatch_(), heartBeatTimer_(sharedService) {}
 
 // destructor: ensures the connection is closed when the object is destroyed.
+// the writer thread is joined here, after close() woke it up.
+// in async mode the io_service thread must be done with this connection before it is deleted.
 ConnectionHandler::~ConnectionHandler() {
+    if (mode_ == IoMode::Async) {
+        connected_ = false;
+        boost::system::error_code ignored;
+        socket_.close(ignored);
+        return;
+    }
     close();
+    if (writerThread_.joinable())
+        writerThread_.join();
 }
 
 // attempts to connect to the server.
 bool ConnectionHandler::connect() {
-    std::cout << "Starting connect to " << host_ << ":" << port_ << std::endl;
+    printConnectTarget();
     try {
-        // Create an endpoint (IP + port) - The "address" of the server application.
-        tcp::endpoint endpoint(boost::asio::ip::address::from_string(host_), port_); 
-        
         boost::system::error_code error;
-        
-        // try to connect the socket to the endpoint.
-        socket_.connect(endpoint, error);
+
+        if (isUnixSocket()) {
+            // Create an endpoint - The "address" of the server application:
+            // a socket file for a broker on the same host.
+            boost::asio::local::stream_protocol::endpoint endpoint(host_.substr(UNIX_PREFIX.length()));
+            socket_.connect(endpoint, error);
+        } else {
+            // IP addresses of host_ (resolved once, then cached across reconnects);
+            // all of them race, the first one to answer wins
+            bool cached = !endpointCache_.empty();
+            if (resolveEndpoints(error))
+                raceConnect(error);
+            if (error && cached) {
+                // the broker may have moved: forget the cache and resolve again
+                endpointCache_.clear();
+                error.clear();
+                if (resolveEndpoints(error))
+                    raceConnect(error);
+            }
+        }
         
         // if the socket reports an error (e.g., server unreachable), throw an exception.
         if (error)
             throw boost::system::system_error(error);
-            
-        connected_ = true;
+
+        finishConnect();
     }
     catch (std::exception &e) {
         std::cerr << "Connection failed (Error: " << e.what() << ')' << std::endl;
@@ -42,23 +145,364 @@ bool ConnectionHandler::connect() {
     return true;
 }
 
+void ConnectionHandler::printConnectTarget() const {
+    if (isUnixSocket())
+        std::cout << "Starting connect to " << host_ << std::endl;
+    else
+        std::cout << "Starting connect to " << host_ << ":" << port_ << std::endl;
+}
+
+// the socket is connected: tune it, reset the heart-beat clocks and start writing
+void ConnectionHandler::finishConnect() {
+    applySocketProfile();
+    if (useIoUring_ && mode_ == IoMode::Blocking)
+        setupIoUring();
+    lastSendMs_ = nowMs();
+    lastReceiveMs_ = nowMs();
+    connected_ = true;
+
+    // start the writer thread that drains the outbound queue
+    // (async mode writes from the io_service thread instead)
+    if (mode_ == IoMode::Blocking)
+        writerThread_ = std::thread(&ConnectionHandler::writerLoop, this);
+}
+
+// numeric addresses need no lookup; names go through the resolver once.
+bool ConnectionHandler::resolveEndpoints(boost::system::error_code &error) {
+    if (!endpointCache_.empty() || cacheNumericEndpoint())
+        return true;
+
+    boost::asio::io_service lookupService;
+    tcp::resolver resolver(lookupService);
+    tcp::resolver::iterator it = resolver.resolve(tcp::resolver::query(host_, std::to_string(port_)), error);
+    if (error)
+        return false;
+    return cacheResolvedEndpoints(it, error);
+}
+
+// async mode: the same, with the lookup as a completion handler on ioService_
+void ConnectionHandler::asyncResolveEndpoints(std::function<void(const boost::system::error_code &)> done) {
+    if (!endpointCache_.empty() || cacheNumericEndpoint()) {
+        done(boost::system::error_code());
+        return;
+    }
+    std::shared_ptr<tcp::resolver> resolver = std::make_shared<tcp::resolver>(ioService_);
+    resolver->async_resolve(tcp::resolver::query(host_, std::to_string(port_)),
+        [this, resolver, done](const boost::system::error_code &error, tcp::resolver::iterator it) {
+            boost::system::error_code result = error;
+            if (!result)
+                cacheResolvedEndpoints(it, result);
+            done(result);
+        });
+}
+
+bool ConnectionHandler::cacheNumericEndpoint() {
+    boost::system::error_code error;
+    boost::asio::ip::address address = boost::asio::ip::address::from_string(host_, error);
+    if (error)
+        return false;
+    endpointCache_.push_back(tcp::endpoint(address, port_));
+    return true;
+}
+
+bool ConnectionHandler::cacheResolvedEndpoints(tcp::resolver::iterator it, boost::system::error_code &error) {
+    // alternate the address families (happy eyeballs), so one broken family cannot
+    // delay every attempt of the other
+    std::vector<tcp::endpoint> v6, v4;
+    for (; it != tcp::resolver::iterator(); ++it) {
+        const tcp::endpoint &endpoint = it->endpoint();
+        std::vector<tcp::endpoint> &family = endpoint.address().is_v6() ? v6 : v4;
+        if (std::find(family.begin(), family.end(), endpoint) == family.end())
+            family.push_back(endpoint);
+    }
+    for (size_t i = 0; i < std::max(v6.size(), v4.size()); i++) {
+        if (i < v6.size())
+            endpointCache_.push_back(v6[i]);
+        if (i < v4.size())
+            endpointCache_.push_back(v4[i]);
+    }
+    if (endpointCache_.empty()) {
+        error = boost::asio::error::host_not_found;
+        return false;
+    }
+    return true;
+}
+
+namespace {
+// one happy-eyeballs race: a new attempt starts every CONNECT_ATTEMPT_DELAY, or as soon as
+// the previous one failed. 'done' runs once, with the winning socket or nullptr if every
+// attempt failed. The pending handlers keep the race alive.
+struct ConnectRace : public std::enable_shared_from_this<ConnectRace> {
+    typedef std::function<void(tcp::socket *, const tcp::endpoint &, const boost::system::error_code &)> Done;
+
+    boost::asio::io_service &service;
+    const std::vector<tcp::endpoint> endpoints;
+    boost::asio::steady_timer stagger;
+    std::vector<std::unique_ptr<tcp::socket>> attempts;
+    size_t failed;
+    bool finished;
+    boost::system::error_code lastError;
+    Done done;
+
+    ConnectRace(boost::asio::io_service &service, const std::vector<tcp::endpoint> &endpoints, Done done)
+        : service(service), endpoints(endpoints), stagger(service), attempts(), failed(0), finished(false),
+          lastError(boost::asio::error::host_not_found), done(done) {}
+
+    void startNext() {
+        if (finished)
+            return;
+        if (endpoints.empty()) {
+            finish(nullptr, tcp::endpoint());
+            return;
+        }
+        if (attempts.size() == endpoints.size())
+            return;
+        size_t index = attempts.size();
+        attempts.emplace_back(new tcp::socket(service));
+        std::shared_ptr<ConnectRace> self = shared_from_this();
+        attempts[index]->async_connect(endpoints[index], [self, index](const boost::system::error_code &result) {
+            if (self->finished)
+                return;
+            if (!result) {
+                self->finish(self->attempts[index].get(), self->endpoints[index]);
+                return;
+            }
+            self->lastError = result;
+            if (++self->failed == self->endpoints.size())
+                self->finish(nullptr, tcp::endpoint());
+            else
+                self->startNext();
+        });
+        stagger.expires_from_now(CONNECT_ATTEMPT_DELAY);
+        stagger.async_wait([self](const boost::system::error_code &result) {
+            if (!result)
+                self->startNext();
+        });
+    }
+
+    void finish(tcp::socket *winner, const tcp::endpoint &endpoint) {
+        finished = true;
+        boost::system::error_code ignored;
+        stagger.cancel(ignored);
+        for (size_t i = 0; i < attempts.size(); i++) {
+            if (attempts[i].get() != winner)
+                attempts[i]->close(ignored);
+        }
+        done(winner, endpoint, winner != nullptr ? boost::system::error_code() : lastError);
+    }
+};
+}
+
+// the race runs on 'service'; the winning descriptor is handed over to socket_ before 'done'.
+void ConnectionHandler::startConnectRace(boost::asio::io_service &service,
+                                         std::function<void(const boost::system::error_code &)> done) {
+    std::make_shared<ConnectRace>(service, endpointCache_,
+        [this, done](tcp::socket *winner, const tcp::endpoint &endpoint, const boost::system::error_code &result) {
+            boost::system::error_code error = result;
+            if (winner != nullptr)
+                adoptSocket(*winner, endpoint, error);
+            done(error);
+        })->startNext();
+}
+
+// blocking connect: the attempts run on a private io_service until the race is decided.
+bool ConnectionHandler::raceConnect(boost::system::error_code &error) {
+    boost::asio::io_service race;
+    startConnectRace(race, [&error](const boost::system::error_code &result) { error = result; });
+    race.run();
+    return !error;
+}
+
+// socket_ takes over a duplicate of the winner's descriptor (the winner itself may belong to
+// another io_service and is closed with the race).
+void ConnectionHandler::adoptSocket(tcp::socket &winner, const tcp::endpoint &endpoint,
+                                    boost::system::error_code &error) {
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+    int fd = ::dup(winner.native_handle());
+    if (fd < 0) {
+        error = boost::system::error_code(errno, boost::system::system_category());
+        return;
+    }
+    socket_.assign(boost::asio::generic::stream_protocol(endpoint.protocol()), fd, error);
+    if (error)
+        ::close(fd);
+}
+
+bool ConnectionHandler::isUnixSocket() const {
+    return host_.compare(0, UNIX_PREFIX.length(), UNIX_PREFIX) == 0;
+}
+
+// the old writer thread is stopped and joined first; data buffered from the dropped
+// connection is thrown away.
+bool ConnectionHandler::reconnect() {
+    if (mode_ == IoMode::Blocking) {
+        close(); // a failed read does not clear connected_, the writer may still be waiting
+        if (writerThread_.joinable())
+            writerThread_.join();
+    }
+    resetConnection();
+
+    if (!connect())
+        return false;
+    if (mode_ == IoMode::Async) {
+        closeReported_ = false;
+        asyncReadFrame();
+    }
+    return true;
+}
+
+// async mode: resolve, race and connect as completion handlers on ioService_, so the event
+// loop (and every other connection on it) keeps running while the broker is unreachable.
+void ConnectionHandler::asyncReconnect(std::function<void(bool)> done) {
+    resetConnection();
+    printConnectTarget();
+
+    std::function<void(const boost::system::error_code &)> connected =
+        [this, done](const boost::system::error_code &error) {
+            if (error) {
+                std::cerr << "Connection failed (Error: " << error.message() << ')' << std::endl;
+                done(false);
+                return;
+            }
+            finishConnect();
+            closeReported_ = false;
+            asyncReadFrame();
+            done(true);
+        };
+
+    if (isUnixSocket()) {
+        boost::asio::local::stream_protocol::endpoint endpoint(host_.substr(UNIX_PREFIX.length()));
+        socket_.async_connect(endpoint, connected);
+        return;
+    }
+    asyncRaceEndpoints(!endpointCache_.empty(), connected);
+}
+
+// a race against the cached addresses that fails is retried once with a fresh lookup
+void ConnectionHandler::asyncRaceEndpoints(bool cached, std::function<void(const boost::system::error_code &)> done) {
+    asyncResolveEndpoints([this, cached, done](const boost::system::error_code &error) {
+        if (error) {
+            done(error);
+            return;
+        }
+        startConnectRace(ioService_, [this, cached, done](const boost::system::error_code &result) {
+            if (result && cached) {
+                // the broker may have moved: forget the cache and resolve again
+                endpointCache_.clear();
+                asyncRaceEndpoints(false, done);
+                return;
+            }
+            done(result);
+        });
+    });
+}
+
+// drops the old socket and everything buffered from it
+void ConnectionHandler::resetConnection() {
+    boost::system::error_code ignored;
+    socket_.close(ignored);
+    {
+        std::lock_guard<std::mutex> lock(outboundMutex_);
+        sealed_ = false; // a new session can end with its own DISCONNECT
+    }
+
+    readStart_ = 0;
+    readEnd_ = 0;
+    asyncReadBuffer_.consume(asyncReadBuffer_.size());
+    asyncSeenBytes_ = 0;
+    asyncScan_.reset();
+    // heart-beating is negotiated again by the next CONNECTED
+    heartBeatSendMs_ = 0;
+    heartBeatReceiveMs_ = 0;
+}
+
+// sets TCP_NODELAY and the kernel buffer sizes. A failing option is reported but not fatal.
+void ConnectionHandler::applySocketProfile() {
+    boost::system::error_code error;
+    if (!isUnixSocket()) {
+        // Nagle only exists for TCP
+        socket_.set_option(tcp::no_delay(profile_.noDelay), error);
+        if (error)
+            std::cerr << "Could not set TCP_NODELAY (Error: " << error.message() << ')' << std::endl;
+    }
+    if (profile_.receiveBufferSize > 0) {
+        socket_.set_option(boost::asio::socket_base::receive_buffer_size(profile_.receiveBufferSize), error);
+        if (error)
+            std::cerr << "Could not set SO_RCVBUF (Error: " << error.message() << ')' << std::endl;
+    }
+    if (profile_.sendBufferSize > 0) {
+        socket_.set_option(boost::asio::socket_base::send_buffer_size(profile_.sendBufferSize), error);
+        if (error)
+            std::cerr << "Could not set SO_SNDBUF (Error: " << error.message() << ')' << std::endl;
+    }
+}
+
+void ConnectionHandler::setupIoUring() {
+    readRing_.reset(new UringTransport());
+    writeRing_.reset(new UringTransport());
+    writeStaging_.resize(WRITE_STAGING_SIZE);
+    int fd = socket_.native_handle();
+    if (!readRing_->init(fd, readBuffer_.data(), readBuffer_.size()) ||
+        !writeRing_->init(fd, writeStaging_.data(), writeStaging_.size())) {
+        std::cerr << "io_uring unavailable, using Boost sockets" << std::endl;
+        readRing_.reset();
+        writeRing_.reset();
+        std::vector<char>().swap(writeStaging_);
+    }
+}
+
+bool ConnectionHandler::pinReaderThread() {
+    if (profile_.readerCpu < 0)
+        return true;
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(profile_.readerCpu, &cpus);
+    int result = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (result != 0) {
+        std::cerr << "Could not pin reader thread to CPU " << profile_.readerCpu
+                  << " (Error: " << std::strerror(result) << ')' << std::endl;
+        return false;
+    }
+    return true;
+#else
+    std::cerr << "Thread pinning is not supported on this platform" << std::endl;
+    return false;
+#endif
+}
+
 // reads'bytesToRead' bytes from the network.
 // TCP is a stream, we might not get all bytes in one shot, so we loop.
 
 bool ConnectionHandler::getBytes(char bytes[], unsigned int bytesToRead) {
     size_t tmp = 0; // counts how many bytes we have read so far OUR PROGRESS*****
+
+    // first hand out whatever is left in the receive buffer from a previous read
+    size_t buffered = std::min<size_t>(readEnd_ - readStart_, bytesToRead);
+    if (buffered > 0) {
+        std::memcpy(bytes, readBuffer_.data() + readStart_, buffered);
+        readStart_ += buffered;
+        tmp = buffered;
+    }
+
     boost::system::error_code error;
     try {
         // We lock specifically for reading if multiple threads share this handler (safety)
         // lock_guard<std::mutex> lock(socketMutex_); 
         
         // loop until we have read exactly the amount requested
+        long long start = nowUs();
         while (!error && bytesToRead > tmp) {
             // read_some: Read whatever is available currently. 
             // it puts it in the buffer at position 'bytes + tmp'.
             // it asks to read 'bytesToRead - tmp' (REMAINING- THings to reads).
-            tmp += socket_.read_some(boost::asio::buffer(bytes + tmp, bytesToRead - tmp), error);
+            size_t received = socket_.read_some(boost::asio::buffer(bytes + tmp, bytesToRead - tmp), error);
+            tmp += received;
+            ioCounters_.readCalls++;
+            ioCounters_.bytesIn += received;
         }
+        ioCounters_.readBlockedUs += nowUs() - start;
         if (error)
             throw boost::system::system_error(error);
     } catch (std::exception &e) {
@@ -77,11 +521,18 @@ bool ConnectionHandler::sendBytes(const char bytes[], int bytesToWrite) {
         
         // Loop until all data is sent
         //meaning temp is <= bytesToWrite meaning we still have more to send
+        long long start = nowUs();
         while (!error && bytesToWrite > tmp) {
             // write_some: Sends a chunk of data returns how much was actually sent.
             //add to temp what we manged to send in this iteration
-            tmp += socket_.write_some(boost::asio::buffer(bytes + tmp, bytesToWrite - tmp), error);
+            size_t sent = socket_.write_some(boost::asio::buffer(bytes + tmp, bytesToWrite - tmp), error);
+            tmp += sent;
+            ioCounters_.writeCalls++;
+            ioCounters_.bytesOut += sent;
+            if (!error && tmp < bytesToWrite)
+                ioCounters_.partialWrites++;
         }
+        ioCounters_.writeBlockedUs += nowUs() - start;
         if (error)
             throw boost::system::system_error(error);
     } catch (std::exception &e) {
@@ -102,21 +553,94 @@ bool ConnectionHandler::sendLine(std::string &line) {
     return sendFrameAscii(line, '\n');
 }
 
-// CRITICAL FOR STOMP: Reads byte by byte until it finds the 'delimiter'.
+// MSG_DONTWAIT keeps the socket itself blocking, so the writer thread is not affected.
+bool ConnectionHandler::busyPollRead(boost::system::error_code &error) {
+    std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::microseconds(profile_.busyPollMicros);
+    do {
+        ssize_t received = ::recv(socket_.native_handle(), readBuffer_.data() + readEnd_,
+                                  readBuffer_.size() - readEnd_, MSG_DONTWAIT);
+        ioCounters_.readCalls++;
+        if (received > 0) {
+            readEnd_ += received;
+            return true;
+        }
+        if (received == 0) {
+            error = boost::asio::error::eof;
+            return true;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            error = boost::system::error_code(errno, boost::system::system_category());
+            return true;
+        }
+    } while (std::chrono::steady_clock::now() < deadline);
+    return false;
+}
+
+// reads as much as the socket has ready (up to the buffer size) into the empty receive buffer.
+bool ConnectionHandler::fillReadBuffer() {
+    boost::system::error_code error;
+    // keep the unread tail (a partial frame) and move it to the front
+    size_t unread = readEnd_ - readStart_;
+    if (unread > 0 && readStart_ > 0)
+        std::memmove(readBuffer_.data(), readBuffer_.data() + readStart_, unread);
+    readStart_ = 0;
+    readEnd_ = unread;
+    long long start = nowUs();
+    try {
+        if (readRing_ != nullptr) {
+            ioCounters_.readCalls++;
+            ssize_t received = readRing_->readFixed(unread, readBuffer_.size() - unread);
+            if (received > 0)
+                readEnd_ += received;
+            else if (received == 0)
+                error = boost::asio::error::eof;
+            else
+                error = boost::system::error_code(-received, boost::system::system_category());
+        } else if (profile_.busyPollMicros <= 0 || !busyPollRead(error)) {
+            ioCounters_.readCalls++;
+            readEnd_ += socket_.read_some(boost::asio::buffer(readBuffer_.data() + unread,
+                                                              readBuffer_.size() - unread), error);
+        }
+        ioCounters_.readBlockedUs += nowUs() - start;
+        ioCounters_.bytesIn += readEnd_ - unread;
+        if (error)
+            throw boost::system::system_error(error);
+        lastReceiveMs_ = nowMs(); // any byte counts as a sign of life, heart-beats included
+    } catch (std::exception &e) {
+        std::cerr << "recv failed (Error: " << e.what() << ')' << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// CRITICAL FOR STOMP: Reads until it finds the 'delimiter'.
 //  frames end with a null character ('\0').
+// the socket is read in big chunks into the receive buffer; we search the chunk for the
+// delimiter and keep whatever comes after it for the next call.
 bool ConnectionHandler::getFrameAscii(std::string &frame, char delimiter) {
-    char ch;
-    // Try to read 1 byte at a time until we hit the delimiter.
     try {
-        do {
-            // read 1 byte into 'ch'
-            if (!getBytes(&ch, 1)) {
+        while (true) {
+            const char *begin = readBuffer_.data() + readStart_;
+            size_t available = readEnd_ - readStart_;
+            const char *found = static_cast<const char *>(std::memchr(begin, delimiter, available));
+            if (found != nullptr) {
+                // the frame ends inside the buffer: take it, skip the delimiter
+                frame.append(begin, found - begin);
+                readStart_ += (found - begin) + 1;
+                return true;
+            }
+            // no delimiter yet: the whole buffer belongs to this frame
+            frame.append(begin, available);
+            readStart_ = readEnd_;
+            if (frame.size() > FrameView::MAX_FRAME_SIZE) {
+                std::cerr << "recv failed (Error: frame larger than " << FrameView::MAX_FRAME_SIZE << " bytes)" << std::endl;
+                return false;
+            }
+            if (!fillReadBuffer()) {
                 return false; // connection closed or error
             }
-            // if it's not the delimiter, append it to our result string
-            if (ch != delimiter) 
-                frame.append(1, ch);
-        } while (delimiter != ch);
+        }
     } catch (std::exception &e) {
         std::cerr << "recv failed2 (Error: " << e.what() << ')' << std::endl;
         return false;
@@ -124,21 +648,745 @@ bool ConnectionHandler::getFrameAscii(std::string &frame, char delimiter) {
     return true;
 }
 
+// copies exactly 'length' bytes: first whatever the receive buffer holds, then one
+// read straight into the destination for the rest (Boost path) or buffer refills.
+bool ConnectionHandler::readExact(char *destination, size_t length) {
+    size_t buffered = std::min(readEnd_ - readStart_, length);
+    std::memcpy(destination, readBuffer_.data() + readStart_, buffered);
+    readStart_ += buffered;
+    size_t copied = buffered;
+
+    if (copied < length && readRing_ == nullptr && profile_.busyPollMicros <= 0) {
+        boost::system::error_code error;
+        CountingTransfer counting = { &ioCounters_.readCalls, nullptr, length - copied };
+        long long start = nowUs();
+        size_t received = boost::asio::read(socket_, boost::asio::buffer(destination + copied, length - copied),
+                                            counting, error);
+        copied += received;
+        ioCounters_.readBlockedUs += nowUs() - start;
+        ioCounters_.bytesIn += received;
+        if (!error)
+            ioCounters_.readCalls++;
+        if (error) {
+            std::cerr << "recv failed (Error: " << error.message() << ')' << std::endl;
+            return false;
+        }
+        lastReceiveMs_ = nowMs();
+    }
+    while (copied < length) {
+        if (!fillReadBuffer())
+            return false;
+        size_t chunk = std::min(readEnd_, length - copied);
+        std::memcpy(destination + copied, readBuffer_.data(), chunk);
+        readStart_ = chunk;
+        copied += chunk;
+    }
+    return true;
+}
+
+// STOMP receive: the headers are read line by line; with a content-length header the body
+// is one exact-size read (no scanning, NULs allowed), without one we scan for the '\0'.
+bool ConnectionHandler::getStompFrame(std::string &frame) {
+    try {
+        // phase 1: headers, up to and including the empty line. Only the line just completed
+        // can be that empty line, so it is the only one looked at (a line may arrive in pieces:
+        // lineStart is where it began in frame)
+        size_t lineStart = frame.size();
+        while (true) {
+            if (frame.empty()) {
+                // heart-beats between frames
+                while (readStart_ < readEnd_ &&
+                       (readBuffer_[readStart_] == '\n' || readBuffer_[readStart_] == '\r'))
+                    readStart_++;
+            }
+            if (readStart_ == readEnd_) {
+                if (!fillReadBuffer())
+                    return false;
+                continue;
+            }
+            const char *begin = readBuffer_.data() + readStart_;
+            size_t available = readEnd_ - readStart_;
+            const char *eol = static_cast<const char *>(std::memchr(begin, '\n', available));
+            size_t lineLength = eol == nullptr ? available : (eol - begin) + 1;
+            const char *nul = static_cast<const char *>(std::memchr(begin, '\0', lineLength));
+            if (nul != nullptr) {
+                // frame ended before its headers did
+                frame.append(begin, nul - begin);
+                readStart_ += (nul - begin) + 1;
+                return true;
+            }
+            frame.append(begin, lineLength);
+            readStart_ += lineLength;
+            if (eol != nullptr) {
+                size_t completed = frame.size() - lineStart;
+                if (completed == 1 || (completed == 2 && frame[lineStart] == '\r'))
+                    break;
+                lineStart = frame.size();
+            }
+            if (frame.size() > FrameView::MAX_FRAME_SIZE) {
+                std::cerr << "recv failed (Error: frame headers larger than " << FrameView::MAX_FRAME_SIZE << " bytes)" << std::endl;
+                return false;
+            }
+        }
+
+        // phase 2: body
+        size_t contentLength = FrameView::findContentLength(frame.data(), frame.size());
+        if (contentLength == FrameView::NO_LENGTH)
+            return getFrameAscii(frame, '\0');
+        // the peer's number, checked before it becomes an allocation (frame.size() is bounded above)
+        if (contentLength > FrameView::MAX_FRAME_SIZE - frame.size()) {
+            std::cerr << "recv failed (Error: content-length " << contentLength << " above the "
+                      << FrameView::MAX_FRAME_SIZE << " byte frame limit)" << std::endl;
+            return false;
+        }
+
+        size_t bodyStart = frame.size();
+        frame.resize(bodyStart + contentLength);
+        char terminator = 0;
+        if (!readExact(&frame[bodyStart], contentLength) || !readExact(&terminator, 1))
+            return false;
+        if (terminator != '\0') {
+            std::cerr << "recv failed (Error: frame body longer than its content-length)" << std::endl;
+            return false;
+        }
+    } catch (std::exception &e) {
+        std::cerr << "recv failed2 (Error: " << e.what() << ')' << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// the frame is parsed where it lies in readBuffer_. Only a frame that does not fit into the
+// buffer is assembled (by getStompFrame) in frameSpill_ and parsed there.
+bool ConnectionHandler::getFrameView(FrameView &frame) {
+    while (true) {
+        size_t length = FrameView::completeFrameLength(readBuffer_.data() + readStart_, readEnd_ - readStart_);
+        if (length == FrameView::FRAME_TOO_LARGE) {
+            std::cerr << "recv failed (Error: frame larger than " << FrameView::MAX_FRAME_SIZE << " bytes)" << std::endl;
+            return false;
+        }
+        if (length > 0) {
+            const char *begin = readBuffer_.data() + readStart_;
+            readStart_ += length;
+            if (frame.parse(begin, length - 1)) {
+                ioCounters_.framesIn++;
+                return true;
+            }
+            continue; // only heart-beats
+        }
+        if (readEnd_ - readStart_ == readBuffer_.size()) {
+            frameSpill_.clear();
+            if (!getStompFrame(frameSpill_))
+                return false;
+            if (frame.parse(frameSpill_.data(), frameSpill_.size())) {
+                ioCounters_.framesIn++;
+                return true;
+            }
+            continue;
+        }
+        if (!fillReadBuffer())
+            return false;
+    }
+}
+
 //  stomp sends the frame string and appends the delimiter.
-//  send the frame content, then send '\0' .
+//  the frame content and the '\0' go out together as one buffer sequence,
+//  so the kernel gets a single gather write (writev) instead of two writes.
 bool ConnectionHandler::sendFrameAscii(const std::string &frame, char delimiter) {
-    // Send the actual content
-    bool result = sendBytes(frame.c_str(), frame.length());
-    if (!result) return false;
-    
-    // send the delimiter \0
-    return sendBytes(&delimiter, 1);
+    std::array<boost::asio::const_buffer, 2> buffers = {{
+        boost::asio::buffer(frame.data(), frame.length()),
+        boost::asio::buffer(&delimiter, 1)
+    }};
+    boost::system::error_code error;
+    try {
+        // write: keeps calling writev until the whole sequence is sent
+        CountingTransfer counting = { &ioCounters_.writeCalls, &ioCounters_.partialWrites, frame.length() + 1 };
+        long long start = nowUs();
+        ioCounters_.bytesOut += boost::asio::write(socket_, buffers, counting, error);
+        ioCounters_.writeBlockedUs += nowUs() - start;
+        if (!error)
+            ioCounters_.writeCalls++;
+        if (error)
+            throw boost::system::system_error(error);
+    } catch (std::exception &e) {
+        std::cerr << "send failed (Error: " << e.what() << ')' << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// terminates the frame with its delimiter and moves it to the back of the outbound queue.
+ConnectionHandler::QueueResult ConnectionHandler::enqueueFrame(std::string frame, char delimiter,
+                                                               SendCallback onSent, Backpressure policy) {
+    OutboundFrame out;
+    frame.push_back(delimiter);
+    out.data = std::move(frame);
+    out.onSent = std::move(onSent);
+    out.last = policy == Backpressure::Final;
+    {
+        std::unique_lock<std::mutex> lock(outboundMutex_);
+        if (policy == Backpressure::Wait && throttled_ && connected_) {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            spaceCv_.wait(lock, [this] { return !throttled_ || !connected_; });
+            outboundStats_.blockedCount++;
+            outboundStats_.blockedTime += std::chrono::steady_clock::now() - start;
+        }
+        if (!connected_ || sealed_)
+            return QueueResult::Closed;
+        if (policy == Backpressure::Fail && throttled_) {
+            outboundStats_.blockedCount++;
+            return QueueResult::WouldBlock;
+        }
+        chargeOutboundLocked(out.data.length());
+        if (policy == Backpressure::Final)
+            sealed_ = true;
+        if (policy == Backpressure::Ignore)
+            control_.push_back(std::move(out));
+        else
+            outbound_.push_back(std::move(out));
+    }
+    if (mode_ == IoMode::Async) {
+        // hop onto the io_service thread, which owns the write chain
+        ioService_.post([this] {
+            if (!writeInProgress_)
+                asyncWriteNext();
+        });
+    } else {
+        outboundCv_.notify_one();
+    }
+    return QueueResult::Queued;
+}
+
+bool ConnectionHandler::queueFrame(std::string frame, char delimiter, SendCallback onSent) {
+    return enqueueFrame(std::move(frame), delimiter, std::move(onSent), Backpressure::Ignore) == QueueResult::Queued;
+}
+
+bool ConnectionHandler::queueFrameWithBackpressure(std::string frame, char delimiter, SendCallback onSent) {
+    return enqueueFrame(std::move(frame), delimiter, std::move(onSent), Backpressure::Wait) == QueueResult::Queued;
+}
+
+ConnectionHandler::QueueResult ConnectionHandler::tryQueueFrame(std::string frame, char delimiter,
+                                                                SendCallback onSent) {
+    return enqueueFrame(std::move(frame), delimiter, std::move(onSent), Backpressure::Fail);
+}
+
+// the end of the bulk lane is behind everything: the control lane drains first at every boundary
+bool ConnectionHandler::queueFinalFrame(std::string frame, char delimiter, SendCallback onSent) {
+    return enqueueFrame(std::move(frame), delimiter, std::move(onSent), Backpressure::Final) == QueueResult::Queued;
+}
+
+// the queue is throttled when it reaches the high mark
+void ConnectionHandler::chargeOutboundLocked(size_t bytes) {
+    outboundBytes_ += bytes;
+    outboundStats_.peakBytes = std::max(outboundStats_.peakBytes, outboundBytes_);
+    if (highWatermark_ > 0 && outboundBytes_ >= highWatermark_)
+        throttled_ = true;
+}
+
+// ... and released once the writer drained it to the low mark
+void ConnectionHandler::releaseOutboundLocked(size_t bytes) {
+    outboundBytes_ -= std::min(bytes, outboundBytes_);
+    if (throttled_ && outboundBytes_ <= lowWatermark_) {
+        throttled_ = false;
+        spaceCv_.notify_all();
+    }
+}
+
+void ConnectionHandler::setOutboundLimits(size_t highBytes, size_t lowBytes) {
+    std::lock_guard<std::mutex> lock(outboundMutex_);
+    highWatermark_ = highBytes;
+    lowWatermark_ = std::min(lowBytes, highBytes);
+    throttled_ = highWatermark_ > 0 && outboundBytes_ >= highWatermark_;
+    if (!throttled_)
+        spaceCv_.notify_all();
+}
+
+void ConnectionHandler::setWriteCoalescing(std::chrono::microseconds budget, size_t maxBytes) {
+    coalesceBudgetUs_ = budget.count();
+    coalesceBytes_ = maxBytes == 0 ? 1 : maxBytes;
+}
+
+ConnectionHandler::IoStats ConnectionHandler::getIoStats() const {
+    IoStats stats;
+    stats.framesIn = ioCounters_.framesIn;
+    stats.framesOut = ioCounters_.framesOut;
+    stats.bytesIn = ioCounters_.bytesIn;
+    stats.bytesOut = ioCounters_.bytesOut;
+    stats.readCalls = ioCounters_.readCalls;
+    stats.writeCalls = ioCounters_.writeCalls;
+    stats.partialWrites = ioCounters_.partialWrites;
+    stats.readBlocked = std::chrono::microseconds(ioCounters_.readBlockedUs);
+    stats.writeBlocked = std::chrono::microseconds(ioCounters_.writeBlockedUs);
+    stats.writeBatches = ioCounters_.writeBatches;
+    stats.coalesceDelay = std::chrono::microseconds(ioCounters_.coalesceDelayUs);
+    stats.framesDropped = ioCounters_.framesDropped;
+    return stats;
+}
+
+ConnectionHandler::OutboundStats ConnectionHandler::getOutboundStats() {
+    std::lock_guard<std::mutex> lock(outboundMutex_);
+    OutboundStats stats = outboundStats_;
+    stats.queuedFrames = control_.size() + outbound_.size();
+    stats.queuedBytes = outboundBytes_;
+    return stats;
+}
+
+std::future<bool> ConnectionHandler::queueFrameWithFuture(std::string frame, char delimiter) {
+    // the promise is shared because std::function needs a copyable callback
+    std::shared_ptr<std::promise<bool>> done = std::make_shared<std::promise<bool>>();
+    std::future<bool> result = done->get_future();
+    if (!queueFrame(std::move(frame), delimiter, [done](bool sent) { done->set_value(sent); }))
+        done->set_value(false);
+    return result;
+}
+
+// writer thread: sleeps until a frame is queued, writes it, reports the result.
+// on close it stops and fails every frame still waiting in the queue.
+// when heart-beating is on, the wait is bounded by the next heart-beat deadline.
+void ConnectionHandler::writerLoop() {
+    long long lastWriteUs = 0;
+    while (true) {
+        std::vector<OutboundFrame> batch;
+        HeartBeatDue heartBeat = HeartBeatDue::None;
+        {
+            std::unique_lock<std::mutex> lock(outboundMutex_);
+            while (control_.empty() && outbound_.empty() && connected_) {
+                long long untilNextMs = 0;
+                heartBeat = heartBeatDue(untilNextMs);
+                if (heartBeat != HeartBeatDue::None)
+                    break;
+                if (untilNextMs < 0)
+                    outboundCv_.wait(lock);
+                else
+                    outboundCv_.wait_for(lock, std::chrono::milliseconds(untilNextMs));
+            }
+            if (!connected_)
+                break;
+            if (heartBeat == HeartBeatDue::None) {
+                // everything already queued goes out in one write, up to the byte limit
+                // (the io_uring writer: as much as fits in its staging buffer)
+                size_t limit = writeRing_ != nullptr ? writeStaging_.size() : coalesceBytes_;
+                size_t staged = 0;
+                takeFramesLocked(batch, staged, limit);
+
+                // adaptive coalescing: a frame that follows the previous write closely is part of
+                // a burst, so the producer gets up to the latency budget to add more frames.
+                // after an idle period (interactive use) the frame goes out right away.
+                long long now = nowUs();
+                bool burst = now - lastWriteUs < coalesceBudgetUs_;
+                if (burst && staged < limit) {
+                    std::chrono::steady_clock::time_point deadline =
+                        std::chrono::steady_clock::now() + std::chrono::microseconds(coalesceBudgetUs_);
+                    while (staged < limit && connected_) {
+                        if (control_.empty() && outbound_.empty()) {
+                            if (outboundCv_.wait_until(lock, deadline) == std::cv_status::timeout)
+                                break;
+                            continue;
+                        }
+                        bool urgent = !control_.empty();
+                        if (!takeFramesLocked(batch, staged, limit) || urgent)
+                            break; // the next frame does not fit, or a control frame must not wait
+                    }
+                    ioCounters_.coalesceDelayUs += nowUs() - now;
+                }
+            }
+        }
+        if (heartBeat == HeartBeatDue::PeerDead) {
+            std::cerr << "Server heart-beat missed, closing connection" << std::endl;
+            close(); // wakes the reader, which reports the disconnect
+            break;
+        }
+        if (heartBeat == HeartBeatDue::Send) {
+            // an EOL between frames is a STOMP heart-beat
+            if (sendBytes("\n", 1))
+                lastSendMs_ = nowMs();
+            continue;
+        }
+        lastWriteUs = nowUs();
+        bool sent = writeRing_ != nullptr ? uringWriteBatch(batch) : gatherWriteBatch(batch);
+        if (sent) {
+            ioCounters_.framesOut += batch.size();
+            ioCounters_.writeBatches++;
+        } else {
+            ioCounters_.framesDropped += batch.size();
+        }
+        lastSendMs_ = nowMs();
+        if (batch.back().last)
+            break; // DISCONNECT is out: the queue is sealed and heart-beats must stop too
+    }
+
+    std::deque<OutboundFrame> dropped;
+    {
+        std::lock_guard<std::mutex> lock(outboundMutex_);
+        dropped.swap(control_);
+        dropped.insert(dropped.end(), std::make_move_iterator(outbound_.begin()),
+                       std::make_move_iterator(outbound_.end()));
+        outbound_.clear();
+        releaseOutboundLocked(outboundBytes_);
+    }
+    ioCounters_.framesDropped += dropped.size();
+    for (OutboundFrame &out : dropped) {
+        if (out.onSent)
+            out.onSent(false);
+    }
+}
+
+// ---------------------------- async mode ----------------------------
+
+void ConnectionHandler::startAsync(FrameHandler onFrame, CloseHandler onClose) {
+    onFrame_ = onFrame;
+    onClose_ = onClose;
+    ioService_.post([this] { asyncReadFrame(); });
+}
+
+// match condition for async_read_until: ends the read after one complete STOMP frame
+// (content-length aware, see completeFrameLength), and since it runs on every chunk that
+// arrives, it also records heart-beats that do not complete a frame.
+// the streambuf's data is contiguous, so the frame is looked for in its buffer directly.
+// like asio's own delimiter match, each call resumes where the previous one stopped (scan),
+// so a frame that arrives in many chunks is scanned once, not once per chunk.
+namespace {
+struct FrameDelimiterMatch {
+    std::atomic<long long> *lastReceiveMs;
+    std::atomic<unsigned long long> *readCalls;
+    size_t *seenBytes;
+    FrameView::Scan *scan;
+    boost::asio::streambuf *buffer;
+    template <typename Iterator>
+    std::pair<Iterator, bool> operator()(Iterator begin, Iterator end) const {
+        *lastReceiveMs = nowMs();
+        if (buffer->size() > *seenBytes)
+            (*readCalls)++; // new bytes: a read completed (not just a rescan of buffered ones)
+        *seenBytes = buffer->size();
+        const char *data = boost::asio::buffer_cast<const char *>(buffer->data());
+        size_t length = FrameView::completeFrameLength(data, buffer->size(), *scan);
+        if (length == 0)
+            return std::make_pair(begin, false);
+        if (length == FrameView::FRAME_TOO_LARGE)
+            return std::make_pair(Iterator::begin(buffer->data()), true); // empty match: the handler fails the read
+        return std::make_pair(Iterator::begin(buffer->data()) + length, true);
+    }
+};
+}
+
+namespace boost {
+namespace asio {
+template <> struct is_match_condition<FrameDelimiterMatch> : public boost::true_type {};
+}
+}
+
+void ConnectionHandler::asyncReadFrame() {
+    FrameDelimiterMatch match = { &lastReceiveMs_, &ioCounters_.readCalls, &asyncSeenBytes_, &asyncScan_, &asyncReadBuffer_ };
+    boost::asio::async_read_until(socket_, asyncReadBuffer_, match,
+        [this](const boost::system::error_code &error, size_t length) {
+            if (error) {
+                if (error != boost::asio::error::operation_aborted)
+                    std::cerr << "recv failed (Error: " << error.message() << ')' << std::endl;
+                asyncShutdown();
+                return;
+            }
+            if (length == 0) {
+                std::cerr << "recv failed (Error: frame larger than " << FrameView::MAX_FRAME_SIZE << " bytes)" << std::endl;
+                asyncShutdown();
+                return;
+            }
+            // 'length' counts up to and including the delimiter; anything after it stays
+            // in the streambuf for the next read
+            // the frame is handed out as a view into the streambuf and consumed afterwards
+            const char *data = boost::asio::buffer_cast<const char *>(asyncReadBuffer_.data());
+            ioCounters_.bytesIn += length;
+            if (asyncFrame_.parse(data, length - 1)) {
+                ioCounters_.framesIn++;
+                if (onFrame_)
+                    onFrame_(asyncFrame_);
+            }
+            asyncReadBuffer_.consume(length);
+            asyncSeenBytes_ = asyncReadBuffer_.size();
+            asyncScan_.reset();
+
+            if (connected_)
+                asyncReadFrame();
+            else
+                asyncShutdown();
+        });
+}
+
+// every frame queued at this point (up to coalesceBytes_, control lane first) goes out in
+// one gather write. The frames move into asyncBatch_, which owns them until the write is done.
+void ConnectionHandler::asyncWriteNext() {
+    std::vector<boost::asio::const_buffer> buffers;
+    size_t total = 0;
+    {
+        std::lock_guard<std::mutex> lock(outboundMutex_);
+        if ((control_.empty() && outbound_.empty()) || !connected_) {
+            writeInProgress_ = false;
+            return;
+        }
+        asyncBatch_.clear();
+        takeFramesLocked(asyncBatch_, total, coalesceBytes_);
+    }
+    buffers.reserve(asyncBatch_.size());
+    for (const OutboundFrame &out : asyncBatch_)
+        buffers.push_back(boost::asio::buffer(out.data));
+    writeInProgress_ = true;
+    CountingTransfer counting = { &ioCounters_.writeCalls, &ioCounters_.partialWrites, total };
+    boost::asio::async_write(socket_, buffers, counting,
+        [this](const boost::system::error_code &error, size_t written) {
+            ioCounters_.bytesOut += written;
+            if (!error) {
+                ioCounters_.writeCalls++;
+                ioCounters_.writeBatches++;
+            }
+            std::vector<OutboundFrame> done;
+            done.swap(asyncBatch_);
+            for (OutboundFrame &out : done) {
+                if (out.data == "\n") // heart-beats are not frames
+                    continue;
+                if (!error)
+                    ioCounters_.framesOut++;
+                else
+                    ioCounters_.framesDropped++;
+                if (out.onSent)
+                    out.onSent(!error);
+            }
+            lastSendMs_ = nowMs();
+            if (error) {
+                std::cerr << "send failed (Error: " << error.message() << ')' << std::endl;
+                writeInProgress_ = false;
+                asyncShutdown();
+                return;
+            }
+            if (done.back().last) {
+                writeInProgress_ = false; // DISCONNECT is out, the sealed queue stays empty
+                return;
+            }
+            asyncWriteNext();
+        });
+}
+
+void ConnectionHandler::asyncShutdown() {
+    std::deque<OutboundFrame> dropped;
+    {
+        std::lock_guard<std::mutex> lock(outboundMutex_);
+        connected_ = false;
+        // a write still in flight owns asyncBatch_, its handler reports those frames
+        dropped.swap(control_);
+        dropped.insert(dropped.end(), std::make_move_iterator(outbound_.begin()),
+                       std::make_move_iterator(outbound_.end()));
+        outbound_.clear();
+        for (const OutboundFrame &out : dropped)
+            releaseOutboundLocked(out.data.length());
+        spaceCv_.notify_all(); // producers waiting for space give up
+    }
+    ioCounters_.framesDropped += dropped.size();
+    for (OutboundFrame &out : dropped) {
+        if (out.onSent)
+            out.onSent(false);
+    }
+    boost::system::error_code ignored;
+    heartBeatTimer_.cancel(ignored);
+    socket_.close(ignored);
+    if (!closeReported_) {
+        closeReported_ = true;
+        if (onClose_)
+            onClose_();
+    }
+}
+
+// moves queued frames into the batch while they fit into 'limit' bytes (the first one always),
+// the control lane before the bulk lane.
+// Returns false if a frame was left in the queue because it did not fit.
+bool ConnectionHandler::takeFramesLocked(std::vector<OutboundFrame> &batch, size_t &staged, size_t limit) {
+    std::deque<OutboundFrame> *lanes[] = { &control_, &outbound_ };
+    for (std::deque<OutboundFrame> *lane : lanes) {
+        while (!lane->empty()) {
+            size_t length = lane->front().data.length();
+            if (!batch.empty() && staged + length > limit)
+                return false;
+            staged += length;
+            releaseOutboundLocked(length);
+            batch.push_back(std::move(lane->front()));
+            lane->pop_front();
+        }
+    }
+    return true;
+}
+
+// one gather write (writev) for the whole batch, however many frames it holds.
+bool ConnectionHandler::gatherWriteBatch(std::vector<OutboundFrame> &batch) {
+    std::vector<boost::asio::const_buffer> buffers;
+    buffers.reserve(batch.size());
+    size_t total = 0;
+    for (const OutboundFrame &out : batch) {
+        buffers.push_back(boost::asio::buffer(out.data));
+        total += out.data.length();
+    }
+    boost::system::error_code error;
+    CountingTransfer counting = { &ioCounters_.writeCalls, &ioCounters_.partialWrites, total };
+    long long start = nowUs();
+    ioCounters_.bytesOut += boost::asio::write(socket_, buffers, counting, error);
+    ioCounters_.writeBlockedUs += nowUs() - start;
+    if (!error)
+        ioCounters_.writeCalls++;
+    else
+        std::cerr << "send failed (Error: " << error.message() << ')' << std::endl;
+
+    for (OutboundFrame &out : batch) {
+        if (out.onSent)
+            out.onSent(!error);
+    }
+    return !error;
+}
+
+// frames are packed back to back into the registered buffer; a frame larger than the
+// buffer goes out in several buffer-sized pieces.
+bool ConnectionHandler::uringWriteBatch(std::vector<OutboundFrame> &batch) {
+    bool sent = true;
+    size_t staged = 0;
+    for (OutboundFrame &out : batch) {
+        const char *data = out.data.data();
+        size_t remaining = out.data.length();
+        while (sent && remaining > 0) {
+            size_t chunk = std::min(remaining, writeStaging_.size() - staged);
+            std::memcpy(writeStaging_.data() + staged, data, chunk);
+            staged += chunk;
+            data += chunk;
+            remaining -= chunk;
+            if (staged == writeStaging_.size()) {
+                sent = uringWriteStaged(staged);
+                staged = 0;
+            }
+        }
+    }
+    if (sent && staged > 0)
+        sent = uringWriteStaged(staged);
+
+    for (OutboundFrame &out : batch) {
+        if (out.onSent)
+            out.onSent(sent);
+    }
+    return sent;
+}
+
+// writes writeStaging_[0, length), resubmitting after short writes.
+bool ConnectionHandler::uringWriteStaged(size_t length) {
+    size_t written = 0;
+    while (written < length) {
+        long long start = nowUs();
+        ssize_t result = writeRing_->writeFixed(written, length - written);
+        ioCounters_.writeBlockedUs += nowUs() - start;
+        ioCounters_.writeCalls++;
+        if (result > 0 && static_cast<size_t>(result) < length - written)
+            ioCounters_.partialWrites++;
+        if (result > 0)
+            ioCounters_.bytesOut += result;
+        if (result <= 0) {
+            boost::system::error_code error(result == 0 ? EPIPE : -result, boost::system::system_category());
+            std::cerr << "send failed (Error: " << error.message() << ')' << std::endl;
+            return false;
+        }
+        written += result;
+    }
+    return true;
+}
+
+void ConnectionHandler::asyncHeartBeat() {
+    long long untilNextMs = 0;
+    HeartBeatDue heartBeat = heartBeatDue(untilNextMs);
+    if (heartBeat == HeartBeatDue::PeerDead) {
+        std::cerr << "Server heart-beat missed, closing connection" << std::endl;
+        asyncShutdown();
+        return;
+    }
+    if (heartBeat == HeartBeatDue::Send) {
+        // queued like a frame so it never lands in the middle of one
+        // (not after DISCONNECT: the broker may already be closing the connection)
+        OutboundFrame beat;
+        beat.data = "\n";
+        {
+            std::lock_guard<std::mutex> lock(outboundMutex_);
+            if (sealed_)
+                return;
+            chargeOutboundLocked(beat.data.length());
+            control_.push_back(std::move(beat));
+        }
+        lastSendMs_ = nowMs();
+        if (!writeInProgress_)
+            asyncWriteNext();
+        heartBeatDue(untilNextMs);
+    }
+    if (untilNextMs < 0)
+        return;
+    heartBeatTimer_.expires_from_now(std::chrono::milliseconds(untilNextMs));
+    heartBeatTimer_.async_wait([this](const boost::system::error_code &error) {
+        if (!error && connected_)
+            asyncHeartBeat();
+    });
+}
+
+// ---------------------------- heart-beating ----------------------------
+
+void ConnectionHandler::startHeartBeat(int sendEveryMs, int expectEveryMs) {
+    heartBeatSendMs_ = sendEveryMs > 0 ? sendEveryMs : 0;
+    heartBeatReceiveMs_ = expectEveryMs > 0 ? expectEveryMs : 0;
+    lastReceiveMs_ = nowMs();
+    if (mode_ == IoMode::Async) {
+        ioService_.post([this] { asyncHeartBeat(); });
+    } else {
+        // the writer re-computes its wait deadline
+        std::lock_guard<std::mutex> lock(outboundMutex_);
+        outboundCv_.notify_all();
+    }
+}
+
+// the broker is dead once a whole receive interval passed on top of the expected one
+// (the STOMP spec asks for some tolerance, network delay included).
+ConnectionHandler::HeartBeatDue ConnectionHandler::heartBeatDue(long long &untilNextMs) const {
+    long long now = nowMs();
+    long long sendEvery = heartBeatSendMs_;
+    long long receiveEvery = heartBeatReceiveMs_;
+    untilNextMs = -1;
+
+    if (receiveEvery > 0) {
+        long long deadline = lastReceiveMs_ + 2 * receiveEvery;
+        if (now >= deadline)
+            return HeartBeatDue::PeerDead;
+        untilNextMs = deadline - now;
+    }
+    if (sendEvery > 0) {
+        long long deadline = lastSendMs_ + sendEvery;
+        if (now >= deadline)
+            return HeartBeatDue::Send;
+        if (untilNextMs < 0 || deadline - now < untilNextMs)
+            untilNextMs = deadline - now;
+    }
+    return HeartBeatDue::None;
 }
 
 //  closes the socket connection.
 void ConnectionHandler::close() {
+    if (mode_ == IoMode::Async) {
+        // the socket belongs to the io_service thread; the shutdown runs there
+        {
+            std::lock_guard<std::mutex> lock(outboundMutex_);
+            connected_ = false;
+        }
+        spaceCv_.notify_all();
+        ioService_.post([this] { asyncShutdown(); });
+        return;
+    }
     try {
-        connected_ = false;
+        {
+            // flip the flag under the queue lock so the writer cannot miss the wake-up
+            std::lock_guard<std::mutex> lock(outboundMutex_);
+            connected_ = false;
+        }
+        outboundCv_.notify_all();
+        spaceCv_.notify_all();
+        // shutdown wakes a reader blocked on the socket (a pending io_uring read
+        // is not cancelled by close alone)
+        boost::system::error_code ignored;
+        socket_.shutdown(boost::asio::socket_base::shutdown_both, ignored);
         socket_.close();
     } catch (...) {
         std::cout << "closing failed: connection already closed" << std::endl;
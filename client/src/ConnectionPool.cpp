@@ -0,0 +1,112 @@
+#include "../include/ConnectionPool.h"
+#include <functional>
+#include <fstream>
+#include <iostream>
+#include <ctime>
+
+ConnectionPool::ConnectionPool(const std::string &host, unsigned short port, size_t size, IoMode mode)
+    : protocol_(), ioService_(), connections_(), dumpThread_(), dumpMutex_(), dumpCv_(), dumpStop_(false) {
+    if (size == 0)
+        size = 1;
+    for (size_t i = 0; i < size; i++) {
+        if (mode == IoMode::Async)
+            connections_.emplace_back(new ConnectionHandler(host, port, ioService_));
+        else
+            connections_.emplace_back(new ConnectionHandler(host, port, mode));
+        connections_.back()->useSharedProtocol(protocol_);
+        connections_.back()->setConnectionId(static_cast<int>(i));
+    }
+}
+
+ConnectionPool::~ConnectionPool() {
+    stopStatsDump();
+}
+
+ConnectionHandler& ConnectionPool::forTopic(const std::string &topic) {
+    return *connections_[std::hash<std::string>()(topic) % connections_.size()];
+}
+
+bool ConnectionPool::connect() {
+    for (size_t i = 0; i < connections_.size(); i++) {
+        if (!connections_[i]->connect()) {
+            for (size_t j = 0; j < i; j++)
+                connections_[j]->close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void ConnectionPool::close() {
+    stopStatsDump();
+    for (auto &connection : connections_)
+        connection->close();
+}
+
+bool ConnectionPool::isConnected() const {
+    for (auto &connection : connections_) {
+        if (connection->isConnected())
+            return true;
+    }
+    return false;
+}
+
+// milliseconds as a double, for the blocked times
+static double toMs(std::chrono::microseconds time) {
+    return time.count() / 1000.0;
+}
+
+void ConnectionPool::printStats(std::ostream &out) {
+    for (auto &connection : connections_) {
+        ConnectionHandler::IoStats io = connection->getIoStats();
+        ConnectionHandler::OutboundStats queue = connection->getOutboundStats();
+        out << "connection " << connection->getConnectionId()
+            << (connection->isConnected() ? "" : " (down)") << ":\n"
+            << "  in:  " << io.framesIn << " frames, " << io.bytesIn << " bytes, "
+            << io.readCalls << " reads (" << io.bytesPerRead() << " bytes/read), blocked "
+            << toMs(io.readBlocked) << " ms\n"
+            << "  out: " << io.framesOut << " frames, " << io.bytesOut << " bytes, "
+            << io.writeCalls << " writes (" << io.partialWrites << " partial), blocked "
+            << toMs(io.writeBlocked) << " ms, " << io.framesDropped << " frames dropped\n"
+            << "  batching: " << io.writeBatches << " batches (" << io.framesPerBatch()
+            << " frames/batch), added delay " << toMs(io.coalesceDelay) << " ms\n"
+            << "  queue: " << queue.queuedFrames << " frames, " << queue.queuedBytes << " bytes (peak "
+            << queue.peakBytes << "), producers blocked " << queue.blockedCount << " times, "
+            << toMs(std::chrono::duration_cast<std::chrono::microseconds>(queue.blockedTime)) << " ms\n";
+    }
+}
+
+// the dump thread sleeps on dumpCv_, so close() does not have to wait for the interval
+void ConnectionPool::startStatsDump(const std::string &path, int intervalMs) {
+    stopStatsDump();
+    dumpStop_ = false;
+    dumpThread_ = std::thread([this, path, intervalMs] {
+        bool stopping = false;
+        while (!stopping) {
+            {
+                std::unique_lock<std::mutex> lock(dumpMutex_);
+                stopping = dumpCv_.wait_for(lock, std::chrono::milliseconds(intervalMs), [this] { return dumpStop_; });
+            }
+            std::ofstream file(path, std::ios::app);
+            if (!file) {
+                std::cerr << "Cannot write stats to " << path << std::endl;
+                return;
+            }
+            std::time_t now = std::time(nullptr);
+            char stamp[32];
+            std::strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+            file << "--- " << stamp << (stopping ? " (final)" : "") << " ---\n";
+            printStats(file);
+        }
+    });
+}
+
+void ConnectionPool::stopStatsDump() {
+    {
+        std::lock_guard<std::mutex> lock(dumpMutex_);
+        dumpStop_ = true;
+    }
+    dumpCv_.notify_all();
+    if (dumpThread_.joinable())
+        dumpThread_.join();
+}
@@ -0,0 +1,50 @@
+#include "../include/DeflateCodec.h"
+#include <zlib.h>
+#include <algorithm>
+
+const int DeflateCodec::DEFAULT_LEVEL;
+
+// inflate grows the output in steps of at least this size
+static const size_t INFLATE_CHUNK = 16 * 1024;
+
+// one-shot compress2 into a buffer sized by compressBound
+bool DeflateCodec::compress(const std::string &in, std::string &out, int level) {
+    uLongf length = compressBound(in.size());
+    out.resize(length);
+    int result = compress2(reinterpret_cast<Bytef *>(&out[0]), &length,
+                           reinterpret_cast<const Bytef *>(in.data()), in.size(), level);
+    if (result != Z_OK)
+        return false;
+    out.resize(length);
+    return true;
+}
+
+// streaming inflate: the uncompressed size is not sent, so the output grows as needed,
+// up to maxOutput
+bool DeflateCodec::decompress(const char *data, size_t length, std::string &out, size_t maxOutput) {
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream.avail_in = length;
+    if (inflateInit(&stream) != Z_OK)
+        return false;
+
+    out.clear();
+    int result = Z_OK;
+    while (result == Z_OK) {
+        size_t written = out.size();
+        if (written == maxOutput)
+            break; // limit reached and the stream is not done: result stays Z_OK, so we fail
+        out.resize(written + std::min(maxOutput - written, std::max(INFLATE_CHUNK, length * 2)));
+        stream.next_out = reinterpret_cast<Bytef *>(&out[written]);
+        stream.avail_out = out.size() - written;
+        result = inflate(&stream, Z_NO_FLUSH);
+        out.resize(out.size() - stream.avail_out);
+        if (result == Z_BUF_ERROR && stream.avail_in > 0)
+            result = Z_OK; // output full, go around again
+    }
+    inflateEnd(&stream);
+    return result == Z_STREAM_END;
+}
@@ -0,0 +1,199 @@
+#include "../include/FrameView.h"
+#include "../include/KeyHash.h"
+
+#include <algorithm>
+
+const size_t StringView::npos;
+const size_t FrameView::NO_LENGTH;
+const size_t FrameView::MAX_FRAME_SIZE;
+const size_t FrameView::FRAME_TOO_LARGE;
+
+StringView FrameView::header(Header name) const {
+    return known[name] == 0 ? StringView() : headers[known[name] - 1].second;
+}
+
+StringView FrameView::header(const char *name) const {
+    for (const std::pair<StringView, StringView> &entry : headers) {
+        if (entry.first == name)
+            return entry.second;
+    }
+    return StringView();
+}
+
+bool FrameView::hasHeader(const char *name) const {
+    for (const std::pair<StringView, StringView> &entry : headers) {
+        if (entry.first == name)
+            return true;
+    }
+    return false;
+}
+
+// four commands, most frequent first: the compares beat hashing the command
+// (bench/KeyDispatchBench.cpp)
+FrameView::Command FrameView::classifyCommand(const StringView &command) {
+    if (command == "MESSAGE") return Message;
+    if (command == "RECEIPT") return Receipt;
+    if (command == "CONNECTED") return Connected;
+    if (command == "ERROR") return Error;
+    return UnknownCommand;
+}
+
+// every header line of every frame goes through here, one hash instead of a compare per name
+FrameView::Header FrameView::classifyHeader(const StringView &name) {
+    Header header;
+    const char *expected;
+    switch (keyHash(name)) {
+    case keyHash("content-length"): header = ContentLength; expected = "content-length"; break;
+    case keyHash("content-encoding"): header = ContentEncoding; expected = "content-encoding"; break;
+    case keyHash("content-type"): header = ContentType; expected = "content-type"; break;
+    case keyHash("receipt-id"): header = ReceiptId; expected = "receipt-id"; break;
+    case keyHash("heart-beat"): header = HeartBeat; expected = "heart-beat"; break;
+    case keyHash("accept-encoding"): header = AcceptEncoding; expected = "accept-encoding"; break;
+    case keyHash("version"): header = Version; expected = "version"; break;
+    case keyHash("subscription"): header = Subscription; expected = "subscription"; break;
+    case keyHash("message-id"): header = MessageId; expected = "message-id"; break;
+    case keyHash("destination"): header = Destination; expected = "destination"; break;
+    default: return KNOWN_HEADERS;
+    }
+    return name == expected ? header : KNOWN_HEADERS;
+}
+
+// one pass over the header block: every line is cut at its first ':' in place,
+// classified and entered into the table as it goes by.
+bool FrameView::parse(const char *data, size_t size) {
+    headers.clear();
+    std::fill(known, known + KNOWN_HEADERS, 0);
+    body = StringView();
+    command = StringView();
+    type = UnknownCommand;
+
+    // heart-beats (EOLs) arrive between frames and end up in front of the next command
+    size_t start = 0;
+    while (start < size && (data[start] == '\n' || data[start] == '\r'))
+        start++;
+    raw = StringView(data + start, size - start);
+    bodyOffset = raw.size;
+    if (raw.empty())
+        return false;
+
+    size_t pos = 0;
+    bool first = true;
+    while (pos < raw.size) {
+        size_t eol = raw.find('\n', pos);
+        size_t next = eol == StringView::npos ? raw.size : eol + 1;
+        StringView line = raw.substr(pos, (eol == StringView::npos ? raw.size : eol) - pos);
+        if (!line.empty() && line.back() == '\r')
+            line.size--;
+        pos = next;
+
+        if (first) {
+            command = line;
+            type = classifyCommand(line);
+            first = false;
+        } else if (line.empty()) {
+            // empty line: the body follows
+            bodyOffset = pos;
+            body = raw.substr(pos);
+            break;
+        } else {
+            size_t colon = line.find(':');
+            if (colon == StringView::npos)
+                headers.push_back(std::make_pair(line, StringView()));
+            else
+                headers.push_back(std::make_pair(line.substr(0, colon), line.substr(colon + 1)));
+            Header name = classifyHeader(headers.back().first);
+            if (name != KNOWN_HEADERS && known[name] == 0)
+                known[name] = headers.size();
+        }
+    }
+
+    // content-length gives the exact body size (the '\0' was already cut off by the reader)
+    StringView length = header(ContentLength);
+    if (!length.empty()) {
+        size_t value = 0;
+        for (size_t i = 0; i < length.size && length.data[i] >= '0' && length.data[i] <= '9'; i++) {
+            value = value * 10 + (length.data[i] - '0');
+            if (value > body.size)
+                break; // larger than what is there: nothing to clamp (and no overflow)
+        }
+        if (value < body.size)
+            body.size = value;
+    }
+    return true;
+}
+
+size_t FrameView::findContentLength(const char *headers, size_t length) {
+    static const char NAME[] = "content-length:";
+    static const size_t NAME_LENGTH = sizeof(NAME) - 1;
+    const char *eol = static_cast<const char *>(std::memchr(headers, '\n', length));
+    while (eol != nullptr) {
+        const char *line = eol + 1;
+        size_t rest = length - (line - headers);
+        if (rest > NAME_LENGTH && std::memcmp(line, NAME, NAME_LENGTH) == 0) {
+            size_t value = 0;
+            const char *digit = line + NAME_LENGTH;
+            const char *end = headers + length;
+            if (digit == end || *digit < '0' || *digit > '9')
+                return NO_LENGTH;
+            for (; digit != end && *digit >= '0' && *digit <= '9'; ++digit) {
+                value = value * 10 + (*digit - '0');
+                if (value > MAX_FRAME_SIZE)
+                    return MAX_FRAME_SIZE + 1;
+            }
+            return value;
+        }
+        eol = static_cast<const char *>(std::memchr(line, '\n', rest));
+    }
+    return NO_LENGTH;
+}
+
+size_t FrameView::completeFrameLength(const char *data, size_t size) {
+    Scan scan;
+    return completeFrameLength(data, size, scan);
+}
+
+size_t FrameView::completeFrameLength(const char *data, size_t size, Scan &scan) {
+    if (scan.headerEnd == NO_LENGTH) {
+        if (scan.scanned == scan.start) {
+            while (scan.start < size && (data[scan.start] == '\n' || data[scan.start] == '\r'))
+                scan.start++;
+            scan.scanned = scan.lineStart = scan.start;
+        }
+        // line by line up to the empty one; a '\0' in the headers ends the frame early
+        // (no empty line after its headers: not valid STOMP, but seen in the wild)
+        while (scan.scanned < size) {
+            const char *eol = static_cast<const char *>(std::memchr(data + scan.scanned, '\n', size - scan.scanned));
+            size_t lineEnd = eol == nullptr ? size : eol - data;
+            const char *early = static_cast<const char *>(std::memchr(data + scan.scanned, '\0', lineEnd - scan.scanned));
+            if (early != nullptr)
+                return (early - data) + 1;
+            if (eol == nullptr) {
+                scan.scanned = size;
+                break;
+            }
+            size_t lineLength = lineEnd - scan.lineStart;
+            scan.scanned = lineEnd + 1;
+            if (lineLength == 0 || (lineLength == 1 && data[scan.lineStart] == '\r')) {
+                scan.headerEnd = scan.scanned - scan.start;
+                scan.contentLength = findContentLength(data + scan.start, scan.headerEnd);
+                break;
+            }
+            scan.lineStart = scan.scanned;
+        }
+        if (scan.headerEnd == NO_LENGTH)
+            return size - scan.start > MAX_FRAME_SIZE ? FRAME_TOO_LARGE : 0;
+    }
+
+    if (scan.contentLength == NO_LENGTH) {
+        const char *nul = static_cast<const char *>(std::memchr(data + scan.scanned, '\0', size - scan.scanned));
+        if (nul != nullptr)
+            return (nul - data) + 1;
+        scan.scanned = size;
+        return size - scan.start > MAX_FRAME_SIZE ? FRAME_TOO_LARGE : 0;
+    }
+    // headerEnd <= MAX_FRAME_SIZE here, so the subtraction cannot wrap and neither can the sum
+    if (scan.headerEnd > MAX_FRAME_SIZE || scan.contentLength > MAX_FRAME_SIZE - scan.headerEnd)
+        return FRAME_TOO_LARGE;
+    size_t frameEnd = scan.start + scan.headerEnd + scan.contentLength + 1;
+    return frameEnd <= size ? frameEnd : 0;
+}
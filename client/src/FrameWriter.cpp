@@ -0,0 +1,16 @@
+#include "../include/FrameWriter.h"
+
+// digits are produced backwards into a stack buffer, then appended in one go
+FrameWriter &FrameWriter::appendNumber(long long value) {
+    char digits[24];
+    char *end = digits + sizeof(digits);
+    char *start = end;
+    unsigned long long magnitude = value < 0 ? 0ULL - static_cast<unsigned long long>(value) : value;
+    do {
+        *--start = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude != 0);
+    if (value < 0)
+        *--start = '-';
+    return append(start, end - start);
+}
@@ -0,0 +1,62 @@
+#include "../include/ReceiptWindow.h"
+
+ReceiptWindow::ReceiptWindow(size_t capacity)
+    : capacity_(capacity == 0 ? 1 : capacity), pending_(), mtx_(), cv_(),
+      aborted_(false), started_(false), start_(), end_(), stats_() {}
+
+bool ReceiptWindow::acquire() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!started_) {
+        started_ = true;
+        start_ = Clock::now();
+    }
+    cv_.wait(lock, [this] { return aborted_ || pending_.size() < capacity_; });
+    return !aborted_;
+}
+
+void ReceiptWindow::sent(const std::string &receiptId) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    pending_[receiptId] = Clock::now();
+    stats_.sent++;
+}
+
+bool ReceiptWindow::acknowledge(const std::string &receiptId) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = pending_.find(receiptId);
+    if (it == pending_.end())
+        return false;
+
+    Clock::time_point now = Clock::now();
+    Clock::duration latency = now - it->second;
+    pending_.erase(it);
+
+    stats_.acked++;
+    stats_.totalLatency += latency;
+    if (latency > stats_.maxLatency)
+        stats_.maxLatency = latency;
+    end_ = now;
+
+    cv_.notify_all();
+    return true;
+}
+
+bool ReceiptWindow::waitAll() {
+    std::unique_lock<std::mutex> lock(mtx_);
+    cv_.wait(lock, [this] { return aborted_ || pending_.empty(); });
+    return !aborted_;
+}
+
+void ReceiptWindow::abort() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    aborted_ = true;
+    end_ = Clock::now();
+    cv_.notify_all();
+}
+
+ReceiptWindow::Stats ReceiptWindow::getStats() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    Stats result = stats_;
+    if (started_ && end_ > start_)
+        result.elapsed = end_ - start_;
+    return result;
+}
@@ -4,7 +4,13 @@
 #include <sstream>
 #include <vector>
 #include "../include/ConnectionHandler.h"
+#include "../include/ConnectionPool.h"
+#include <chrono>
+#include <memory>
+#include <algorithm>
 #include "event.h"
+#include "ReceiptWindow.h"
+#include "TokenBucket.h"
 using namespace std;
 
 
@@ -20,57 +26,388 @@ vector< string> split(const string& str, char delimiter) {
     return tokens;
 }
 
+// options of the report command: report [--window N] [--rate N/s [--burst M]] filename
+struct ReportOptions {
+    string filename;
+    size_t window; // max SEND frames waiting for a receipt, 0 = no receipts
+    double rate;   // SEND frames per second, 0 = as fast as the socket takes them
+    size_t burst;  // SEND frames that may go out back to back when paced
+    ReportOptions() : filename(), window(0), rate(0), burst(1) {}
+};
+
+bool parseReportOptions(const vector<string>& tokens, ReportOptions& options) {
+    if (tokens.size() < 2)
+        return false;
+    // everything between the command and the filename is an option
+    for (size_t i = 1; i + 1 < tokens.size(); i++) {
+        try {
+            if (tokens[i] == "--window" && i + 2 < tokens.size()) {
+                int window = stoi(tokens[++i]);
+                if (window <= 0)
+                    return false;
+                options.window = window;
+            } else if (tokens[i] == "--rate" && i + 2 < tokens.size()) {
+                // "100/s" or just "100"
+                string value = tokens[++i];
+                if (value.size() > 2 && value.compare(value.size() - 2, 2, "/s") == 0)
+                    value.erase(value.size() - 2);
+                size_t used = 0;
+                double rate = stod(value, &used);
+                if (used != value.size() || rate <= 0)
+                    return false;
+                options.rate = rate;
+            } else if (tokens[i] == "--burst" && i + 2 < tokens.size()) {
+                int burst = stoi(tokens[++i]);
+                if (burst <= 0)
+                    return false;
+                options.burst = burst;
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    options.filename = tokens.back();
+    return true;
+}
+
+// registers a report's receipt window with the protocol (RECEIPT frames and lost connections
+// reach it from the reader threads) and unregisters it on every way out of the report,
+// before the window itself goes away
+class ReportWindowGuard {
+public:
+    ReportWindowGuard(StompProtocol& protocol, ReceiptWindow* window, int connectionId) : protocol_(protocol) {
+        protocol_.setReportWindow(window, connectionId);
+    }
+    ~ReportWindowGuard() { protocol_.setReportWindow(nullptr); }
+    ReportWindowGuard(const ReportWindowGuard&) = delete;
+    ReportWindowGuard& operator=(const ReportWindowGuard&) = delete;
+
+private:
+    StompProtocol& protocol_;
+};
+
+// prints the outcome of a pipelined report: throughput and send -> receipt latency
+void printReportStats(const ReceiptWindow::Stats& stats, bool confirmed, size_t total) {
+    using namespace std::chrono;
+    double seconds = duration_cast<duration<double>>(stats.elapsed).count();
+    double avgLatencyUs = stats.acked == 0 ? 0 :
+        duration_cast<duration<double, std::micro>>(stats.totalLatency).count() / stats.acked;
+    double maxLatencyUs = duration_cast<duration<double, std::micro>>(stats.maxLatency).count();
+
+    if (confirmed)
+        cout << "Report confirmed: " << stats.acked << "/" << total << " events acknowledged" << endl;
+    else
+        cout << "Report incomplete: " << stats.acked << "/" << total << " events acknowledged" << endl;
+    cout << "  time: " << seconds * 1000 << " ms, throughput: "
+         << (seconds > 0 ? stats.acked / seconds : 0) << " events/s" << endl;
+    cout << "  ack latency: avg " << avgLatencyUs << " us, max " << maxLatencyUs << " us" << endl;
+}
+
+// paced report: the rate that was reached and how late the sleeps woke up
+void printPacingStats(const TokenBucket& bucket) {
+    using namespace std::chrono;
+    TokenBucket::Stats stats = bucket.getStats();
+    double seconds = duration_cast<duration<double>>(stats.elapsed).count();
+    // the first 'burst' frames go out at once, the rest are paced over 'elapsed'
+    size_t paced = stats.granted > bucket.getBurst() ? stats.granted - bucket.getBurst() : 0;
+    double achieved = seconds > 0 ? paced / seconds : 0;
+    double avgLateUs = stats.delayed == 0 ? 0 :
+        duration_cast<duration<double, std::micro>>(stats.totalLateness).count() / stats.delayed;
+    double maxLateUs = duration_cast<duration<double, std::micro>>(stats.maxLateness).count();
+    cout << "  pacing: " << achieved << " events/s (target " << bucket.getRate() << "/s, burst "
+         << bucket.getBurst() << "), jitter: avg " << avgLateUs << " us, max " << maxLateUs << " us" << endl;
+}
+
+// outbound queue of the report's connection: only worth mentioning when the budget was hit
+void printBackpressureStats(const ConnectionHandler::OutboundStats& stats) {
+    if (stats.blockedCount == 0)
+        return;
+    double blockedMs = chrono::duration_cast<chrono::duration<double, std::milli>>(stats.blockedTime).count();
+    cout << "  backpressure: blocked " << stats.blockedCount << " times for " << blockedMs
+         << " ms, peak queue " << stats.peakBytes << " bytes, " << stats.queuedFrames
+         << " frames (" << stats.queuedBytes << " bytes) still queued" << endl;
+}
+
+// bytes saved by deflating this report's bodies, and what it cost
+void printCompressionStats(const StompProtocol::CompressionStats& before, const StompProtocol::CompressionStats& after) {
+    size_t bodies = after.bodies - before.bodies;
+    if (bodies == 0)
+        return;
+    size_t rawBytes = after.rawBytes - before.rawBytes;
+    size_t compressedBytes = after.compressedBytes - before.compressedBytes;
+    cout << "  compression: " << bodies << " bodies, " << rawBytes << " -> " << compressedBytes
+         << " bytes (" << (rawBytes > 0 ? 100.0 * compressedBytes / rawBytes : 0) << "%), "
+         << after.deflateMs - before.deflateMs << " ms deflating" << endl;
+}
+
+// frame dispatch, shared by the blocking reader thread and the async completion handler.
+// the frame is a view into the connection's receive buffer (heart-beat EOLs already skipped).
+// returns false when the connection should stop reading (ERROR frame).
+bool handleServerFrame(ConnectionHandler* handler, const FrameView& frame) {
+    //process the frame based on the command
+    switch (frame.type) {
+    case FrameView::Connected: {
+        // in pool mode every connection logs in, report it once
+        if (handler->getConnectionId() == 0)
+             cout << "Login successful" <<  endl;
+        handler->getProtocol().connectionEstablished(handler->getConnectionId());
+        handler->getProtocol().setLoggedIn(true);
+
+        int sendEveryMs = 0, expectEveryMs = 0;
+        handler->getProtocol().negotiateHeartBeat(frame, sendEveryMs, expectEveryMs);
+        handler->getProtocol().negotiateCompression(frame);
+        if (sendEveryMs > 0 || expectEveryMs > 0)
+            handler->startHeartBeat(sendEveryMs, expectEveryMs);
+
+        // after an automatic reconnect: restore every subscription in one go
+        vector<string> resubscribe = handler->getProtocol().buildResubscribeFrames(handler->getConnectionId());
+        for (string& subscribe : resubscribe)
+            handler->queueFrame(std::move(subscribe), '\0');
+        if (!resubscribe.empty())
+            cout << "Restored " << resubscribe.size() << " subscriptions" << endl;
+        break;
+    }
+    case FrameView::Error:
+        // if error, print it and close connection. The session fails as a whole: the main
+        // thread closes the other connections of a pool before the next command
+         cerr << "Error from server:\n" << frame.raw <<  endl;
+        handler->getProtocol().sessionFailed(handler->getConnectionId());
+        handler->close(); 
+        return false;
+        
+    case FrameView::Message:
+        // delegate business logic to the protocol class
+        handler->getProtocol().handleMessageFrame(frame);
+        break;
+        
+    case FrameView::Receipt:
+        // Check if it's a logout receipt or a report receipt
+        if (frame.hasHeader(FrameView::ReceiptId)) {
+            // Notify the protocol: either the logout receipt (main thread will wake up
+            // and close the socket) or the receipt of a pipelined report SEND
+            handler->getProtocol().processReceipt(frame.header(FrameView::ReceiptId).str());
+        }
+        break;
+
+    case FrameView::UnknownCommand:
+        break;
+    }
+    return true;
+}
+
+// auto-reconnect: wait 100ms, 200ms, 400ms ... (at most 5s) between attempts
+static const int RECONNECT_ATTEMPTS = 10;
+static const int RECONNECT_FIRST_DELAY_MS = 100;
+static const int RECONNECT_MAX_DELAY_MS = 5000;
+
+int reconnectDelayMs(int attempt) {
+    int delay = RECONNECT_FIRST_DELAY_MS << min(attempt, 16);
+    return min(delay, RECONNECT_MAX_DELAY_MS);
+}
+
+// a dropped connection is only restored while the user is logged in
+// (logout clears that flag first) and the server did not reject the session with an ERROR
+bool shouldReconnect(ConnectionHandler* handler, bool autoReconnect) {
+    return autoReconnect && handler->getProtocol().isLoggedIn() && !handler->getProtocol().hasSessionFailed();
+}
+
+// connection is up again: log in with the same credentials, the subscriptions follow on CONNECTED
+void resumeSession(ConnectionHandler* handler) {
+    cout << "Reconnected to server" << endl;
+    handler->queueFrame(handler->getProtocol().buildReconnectFrame(handler->getConnectionId()), '\0');
+}
+
 // socket reader thread
 //  function runs in a separate thread.
 // its ONLY job is to listen to the server and process incoming messages.
-void socketReaderThread(ConnectionHandler* handler) {
-    while (handler->isConnected()) {
-        string frame;
-        
-        // read from socket until '\0' (Blocking call - waits for data)
-        // if false, it means connection is closed or error occurred.
-        if (!handler->getFrameAscii(frame, '\0')) {
-             cout << "Disconnected from server." <<  endl;
-            break;
-        }
-        
-        //process the frame based on the command
-        if (frame.substr(0, 9) == "CONNECTED") {
-             cout << "Login successful" <<  endl;
-            handler->getProtocol().setLoggedIn(true);
-            
-        } else if (frame.substr(0, 5) == "ERROR") {
-            // if error, print it and close connection
-             cerr << "Error from server:\n" << frame <<  endl;
-            handler->close(); 
-            handler->getProtocol().setLoggedIn(false); // Update status
-            break;
-            
-        } else if (frame.substr(0, 7) == "MESSAGE") {
-            // delegate business logic to the protocol class
-            handler->getProtocol().handleMessageFrame(frame);
+void socketReaderThread(ConnectionHandler* handler, bool autoReconnect) {
+    handler->pinReaderThread();
+    while (true) {
+        // one frame object for the whole connection: it only holds views into the receive buffer
+        FrameView frame;
+        while (handler->isConnected()) {
+            // read from socket until '\0' (Blocking call - waits for data)
+            // if false, it means connection is closed or error occurred.
+            if (!handler->getFrameView(frame)) {
+                 cout << "Disconnected from server." <<  endl;
+                break;
+            }
             
-        } else  if (frame.substr(0, 7) == "RECEIPT") {
-            // Check if it's a logout receipt
-           size_t pos = frame.find("receipt-id:");
-            if (pos != std::string::npos) {
-                std::string receiptId = frame.substr(pos + 11);
-                receiptId = receiptId.substr(0, receiptId.find('\n'));
-
-                // Notify the protocol about the logout receipt
-                //main thread will wake up and close the socket
-                handler->getProtocol().processLogoutReceipt(receiptId);
+            if (!handleServerFrame(handler, frame))
+                break;
+        }
+        handler->getProtocol().connectionLost(handler->getConnectionId());
+
+        // auto-reconnect: retry with exponential backoff, then go back to reading
+        bool reconnected = false;
+        for (int attempt = 0; attempt < RECONNECT_ATTEMPTS && shouldReconnect(handler, autoReconnect); attempt++) {
+            this_thread::sleep_for(chrono::milliseconds(reconnectDelayMs(attempt)));
+            if (shouldReconnect(handler, autoReconnect) && handler->reconnect()) {
+                reconnected = true;
+                break;
             }
         }
+        if (!reconnected)
+            break;
+        resumeSession(handler);
+    }
+}
+
+// async mode: retry on a timer, so the event loop is not blocked between attempts
+void scheduleAsyncReconnect(ConnectionHandler* handler, int attempt) {
+    if (attempt >= RECONNECT_ATTEMPTS || !shouldReconnect(handler, true))
+        return;
+    auto timer = make_shared<boost::asio::steady_timer>(handler->getIoService());
+    timer->expires_from_now(chrono::milliseconds(reconnectDelayMs(attempt)));
+    timer->async_wait([handler, attempt, timer](const boost::system::error_code&) {
+        if (!shouldReconnect(handler, true))
+            return;
+        // the connect itself is asynchronous too: the loop keeps serving the other handlers
+        handler->asyncReconnect([handler, attempt](bool connected) {
+            if (connected)
+                resumeSession(handler);
+            else
+                scheduleAsyncReconnect(handler, attempt + 1);
+        });
+    });
+}
+
+// async mode: a single thread runs the pool's io_service, frames of every connection
+// arrive as completion handlers on it.
+void ioServiceThread(ConnectionPool* pool, bool autoReconnect) {
+    pool->at(0).pinReaderThread();
+    for (size_t i = 0; i < pool->size(); i++) {
+        ConnectionHandler* handler = &pool->at(i);
+        handler->startAsync(
+            [handler](const FrameView& frame) { handleServerFrame(handler, frame); },
+            [handler, autoReconnect] {
+                cout << "Disconnected from server." << endl;
+                handler->getProtocol().connectionLost(handler->getConnectionId());
+                if (autoReconnect)
+                    scheduleAsyncReconnect(handler, 0);
+            });
     }
+    pool->getIoService().run();
+}
+
+// stops the session for good: no reconnects, every connection closed, the threads joined
+void closePool(ConnectionPool*& pool, vector<thread*>& readerThreads) {
+    pool->getProtocol().setLoggedIn(false); // stops any reconnect attempts
+    pool->close();
+    for (thread* t : readerThreads) {
+        t->join();
+        delete t;
+    }
+    readerThreads.clear();
+    delete pool;
+    pool = nullptr;
 }
 
 // --- main thread: user input handler ---
 int main(int argc, char* argv[]) {
-    // pointers to manage the connection and the listener thread
-    ConnectionHandler* handler = nullptr;
-    thread* readerThread = nullptr;
+    // pointers to manage the connections and their listener threads
+    // (one connection unless --connections N asks for a pool)
+    ConnectionPool* pool = nullptr;
+    vector<thread*> readerThreads;
     
+    // "--async" runs the connection on a Boost.Asio event loop instead of blocking threads
+    // "--profile default|low-latency|throughput" picks the socket tuning,
+    // "--cpu N" pins the reader thread, "--busy-poll US" spins on reads before blocking
+    // "--io-uring" reads and writes through io_uring when the kernel supports it
+    // "--heart-beat SEND,RECEIVE" offers STOMP heart-beat intervals in ms (0,0 turns it off)
+    IoMode ioMode = IoMode::Blocking;
+    SocketProfile profile;
+    bool useIoUring = false;
+    int heartBeatSendMs = 10000, heartBeatReceiveMs = 10000;
+    // "--auto-reconnect" restores a dropped connection (login and subscriptions)
+    bool autoReconnect = false;
+    // "--connections N" spreads the joined games over N broker connections. Each of them
+    // logs in with the same user, so this needs a broker that accepts several sessions per
+    // user; one that answers the second CONNECT with an ERROR fails the whole login
+    int poolSize = 1;
+    // "--outbound-limit HIGH,LOW" byte budget of each outbound queue in KB (0 = unbounded):
+    // report waits at HIGH until the queue drained to LOW
+    size_t outboundHighKb = 1024, outboundLowKb = 512;
+    // "--stats-file PATH" appends the I/O statistics to PATH every "--stats-interval S" seconds
+    string statsFile;
+    int statsIntervalSec = 10;
+    // "--coalesce US,BYTES" merges a burst of frames into one write: wait at most US for
+    // more frames, write at most BYTES at once (0,... writes every frame on its own timing)
+    int coalesceUs = 200, coalesceBytes = 64 * 1024;
+    // "--compress BYTES" deflates SEND bodies of at least BYTES if the broker supports it (0 = off)
+    size_t compressThreshold = 0;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        try {
+            if (arg == "--async") {
+                ioMode = IoMode::Async;
+            } else if (arg == "--auto-reconnect") {
+                autoReconnect = true;
+            } else if (arg == "--connections" && i + 1 < argc) {
+                poolSize = stoi(argv[++i]);
+                if (poolSize < 1)
+                    throw std::invalid_argument(arg);
+            } else if (arg == "--io-uring") {
+                useIoUring = true;
+            } else if (arg == "--heart-beat" && i + 1 < argc) {
+                string value = argv[++i];
+                size_t comma = value.find(',');
+                if (comma == string::npos)
+                    throw std::invalid_argument(value);
+                heartBeatSendMs = stoi(value.substr(0, comma));
+                heartBeatReceiveMs = stoi(value.substr(comma + 1));
+            } else if (arg == "--outbound-limit" && i + 1 < argc) {
+                string value = argv[++i];
+                size_t comma = value.find(',');
+                if (comma == string::npos)
+                    throw std::invalid_argument(value);
+                int high = stoi(value.substr(0, comma));
+                int low = stoi(value.substr(comma + 1));
+                if (high < 0 || low < 0 || low > high)
+                    throw std::invalid_argument(value);
+                outboundHighKb = high;
+                outboundLowKb = low;
+            } else if (arg == "--stats-file" && i + 1 < argc) {
+                statsFile = argv[++i];
+            } else if (arg == "--stats-interval" && i + 1 < argc) {
+                statsIntervalSec = stoi(argv[++i]);
+                if (statsIntervalSec < 1)
+                    throw std::invalid_argument(arg);
+            } else if (arg == "--coalesce" && i + 1 < argc) {
+                string value = argv[++i];
+                size_t comma = value.find(',');
+                if (comma == string::npos)
+                    throw std::invalid_argument(value);
+                coalesceUs = stoi(value.substr(0, comma));
+                coalesceBytes = stoi(value.substr(comma + 1));
+                if (coalesceUs < 0 || coalesceBytes < 1)
+                    throw std::invalid_argument(value);
+            } else if (arg == "--compress" && i + 1 < argc) {
+                int threshold = stoi(argv[++i]);
+                if (threshold < 0)
+                    throw std::invalid_argument(arg);
+                compressThreshold = threshold;
+            } else if (arg == "--profile" && i + 1 < argc) {
+                if (!SocketProfile::fromName(argv[++i], profile)) {
+                    cerr << "Unknown socket profile: " << argv[i] << endl;
+                    return 1;
+                }
+            } else if (arg == "--cpu" && i + 1 < argc) {
+                profile.readerCpu = stoi(argv[++i]);
+            } else if (arg == "--busy-poll" && i + 1 < argc) {
+                profile.busyPollMicros = stoi(argv[++i]);
+            } else {
+                cerr << "Unknown option: " << arg << endl;
+                return 1;
+            }
+        } catch (const std::exception&) {
+            cerr << "Invalid value for " << arg << endl;
+            return 1;
+        }
+    }
+
     string line;
     
     // loop forever, reading lines from keyboard (Standard Input)
@@ -81,55 +418,103 @@ int main(int argc, char* argv[]) {
         if (tokens.empty()) continue;
         
         string command = tokens[0];
+
+        // a connection got an ERROR since the last command: that session is over
+        if (pool != nullptr && pool->getProtocol().hasSessionFailed()) {
+            if (pool->size() > 1)
+                cerr << "Session closed: the server rejected connection "
+                     << pool->getProtocol().getFailedConnection() << " of the pool" << endl;
+            closePool(pool, readerThreads);
+        }
         
         // --- command: LOGIN ---
         if (command == "login") {
             // validation checks if there are enough arguments
             if (tokens.size() != 4) {
-                cerr << "Usage: login host:port username password" << endl;
+                cerr << "Usage: login host:port|unix:/path username password" << endl;
                 continue;
             }
             // check if already connected
-            if (handler != nullptr && handler->isConnected()) {
+            if (pool != nullptr && pool->isConnected()) {
                 cerr << "The client is already logged in, log out before trying again" << endl;
                 continue;
             }
             
             // parse Host and Port
             string hostPort = tokens[1];
+            string host;
+            unsigned short port = 0;
 
-            //find separator ':'
-            size_t colonPos = hostPort.find(':');
-            if (colonPos == string::npos) {
-                cerr << "Invalid host:port format" << endl;
-                continue;
+            if (hostPort.compare(0, 5, "unix:") == 0) {
+                // co-located broker: "unix:/path/to/sock", no port
+                host = hostPort;
+            } else {
+                //find separator ':'
+                size_t colonPos = hostPort.find(':');
+                if (colonPos == string::npos) {
+                    cerr << "Invalid host:port format" << endl;
+                    continue;
+                }
+                // extract host and port
+                host = hostPort.substr(0, colonPos);
+                int number = 0;
+                try {
+                    number = stoi(hostPort.substr(colonPos + 1));
+                } catch (const std::exception&) {
+                    cerr << "Invalid host:port format" << endl;
+                    continue;
+                }
+                if (number < 1 || number > 65535) {
+                    cerr << "Invalid port " << number << " (1-65535)" << endl;
+                    continue;
+                }
+                port = static_cast<unsigned short>(number);
             }
-            // extract host and port
-             string host = hostPort.substr(0, colonPos);
-            short port =  stoi(hostPort.substr(colonPos + 1));
             
+            // a previous session that dropped for good
+            if (pool != nullptr)
+                closePool(pool, readerThreads);
+
             // connect physically (TCP Handshake)
-            handler = new ConnectionHandler(host, port);
-            if (!handler->connect()) {
+            pool = new ConnectionPool(host, port, poolSize, ioMode);
+            for (size_t i = 0; i < pool->size(); i++) {
+                pool->at(i).setSocketProfile(profile);
+                pool->at(i).setUseIoUring(useIoUring);
+                pool->at(i).setOutboundLimits(outboundHighKb * 1024, outboundLowKb * 1024);
+                pool->at(i).setWriteCoalescing(chrono::microseconds(coalesceUs), coalesceBytes);
+            }
+            pool->getProtocol().setHeartBeat(heartBeatSendMs, heartBeatReceiveMs);
+            pool->getProtocol().setCompression(compressThreshold);
+            if (!pool->connect()) {
                  cerr << "Could not connect to server" <<  endl;
-                delete handler;
-                handler = nullptr;
+                delete pool;
+                pool = nullptr;
                 continue;
             }
             
-            // start the listener thread immediately!
-            // We need it running BEFORE we send the CONNECT frame, 
+            if (!statsFile.empty())
+                pool->startStatsDump(statsFile, statsIntervalSec * 1000);
+
+            // start the listener threads immediately!
+            // We need them running BEFORE we send the CONNECT frame, 
             // so we can catch the CONNECTED response.
-            readerThread = new thread(socketReaderThread, handler);
+            // (async mode: one event loop thread for the whole pool)
+            if (ioMode == IoMode::Async) {
+                readerThreads.push_back(new thread(ioServiceThread, pool, autoReconnect));
+            } else {
+                for (size_t i = 0; i < pool->size(); i++)
+                    readerThreads.push_back(new thread(socketReaderThread, &pool->at(i), autoReconnect));
+            }
 
-            // send STOMP CONNECT frame
-             string connectFrame = handler->getProtocol().buildConnectFrame(host, tokens[2], tokens[3]);
-            handler->sendFrameAscii(connectFrame, '\0');            
+            // send STOMP CONNECT frame (on every connection)
+             string connectFrame = pool->getProtocol().buildConnectFrame(host, tokens[2], tokens[3]);
+            for (size_t i = 0; i < pool->size(); i++)
+                pool->at(i).queueFrame(connectFrame, '\0');
         }
         
         // --- Checks for other commands ---
         // Verify we are connected before trying to send anything
-        else if (handler == nullptr || !handler->isConnected()) {
+        else if (pool == nullptr || !pool->isConnected()) {
              cerr << "Not connected to server" <<  endl;
             continue;
         }
@@ -141,9 +526,15 @@ int main(int argc, char* argv[]) {
                 continue;
             }
              string gameName = tokens[1];
+            // the game's connection in the pool
+            ConnectionHandler& handler = pool->forTopic("/" + gameName);
             // protocol builds the SUBSCRIBE frame
-             string frame = handler->getProtocol().buildSubscribeFrame("/" + gameName);
-            handler->sendFrameAscii(frame, '\0');
+             string frame = pool->getProtocol().buildSubscribeFrame("/" + gameName, handler.getConnectionId());
+            if (!handler.queueFrame(std::move(frame), '\0')) {
+                 cerr << "Could not join " << gameName << ": connection " << handler.getConnectionId()
+                      << " is down" <<  endl;
+                continue;
+            }
              cout << "Joined channel " << gameName <<  endl;
         }
         
@@ -156,26 +547,32 @@ int main(int argc, char* argv[]) {
             //get game name
              string gameName = tokens[1];
             // we need to find the Subscription ID to unsubscribe
-             string subId = handler->getProtocol().getSubscriptionIdByTopic("/" + gameName);
+             string subId = pool->getProtocol().getSubscriptionIdByTopic("/" + gameName);
             
             if (subId == "") {
                  cerr << "Error: You are not subscribed to " << gameName <<  endl;
                 continue;
             }
             // build and send the UNSUBSCRIBE frame
-             string frame = handler->getProtocol().buildUnsubscribeFrame(subId);
-             ///seinding....
-            handler->sendFrameAscii(frame, '\0');
+             string frame = pool->getProtocol().buildUnsubscribeFrame(subId);
+             ///seinding.... (on the connection that carries the subscription)
+            ConnectionHandler& handler = pool->forTopic("/" + gameName);
+            if (!handler.queueFrame(std::move(frame), '\0')) {
+                 cerr << "Could not exit " << gameName << ": connection " << handler.getConnectionId()
+                      << " is down" <<  endl;
+                continue;
+            }
              cout << "Exited channel " << gameName <<  endl;
         }
         
         // --- Command: REPORT ---
         else if (command == "report") {
-            if (tokens.size() != 2) {
-                 cerr << "Usage: report filename" <<  endl;
+            ReportOptions options;
+            if (!parseReportOptions(tokens, options)) {
+                 cerr << "Usage: report [--window N] [--rate N/s [--burst M]] filename" <<  endl;
                 continue;
             }
-             string filename = tokens[1];
+             string filename = options.filename;
             
             // Parse the JSON file (provided logic)
             try {
@@ -183,16 +580,51 @@ int main(int argc, char* argv[]) {
                 
                 std::string gameName = nae.team_a_name + "_" + nae.team_b_name;
                 std::string topic = "/" + gameName;
+                ConnectionHandler& handler = pool->forTopic(topic);
+                StompProtocol& protocol = pool->getProtocol();
+
+                StompProtocol::CompressionStats compressionBefore = protocol.getCompressionStats();
+
+                // pipelined mode: every SEND asks for a receipt, at most 'window' of them unacknowledged
+                std::unique_ptr<ReceiptWindow> window;
+                if (options.window > 0)
+                    window.reset(new ReceiptWindow(options.window));
+                ReportWindowGuard windowGuard(protocol, window.get(), handler.getConnectionId());
                 
+                // paced mode: a token bucket spaces the SEND frames out
+                std::unique_ptr<TokenBucket> bucket;
+                if (options.rate > 0)
+                    bucket.reset(new TokenBucket(options.rate, options.burst));
+
                 for (const Event& event : nae.events) {
-                    std::string sendFrame = handler->getProtocol().buildSendFrame(
-                        topic, event, handler->getProtocol().getCurrentUsername(), filename);
+                    if (bucket != nullptr)
+                        bucket->acquire();
+                    std::string receiptId;
+                    if (window != nullptr) {
+                        if (!window->acquire())
+                            break; // connection lost
+                        receiptId = protocol.generateReceiptId();
+                        window->sent(receiptId);
+                    }
+
+                    std::string sendFrame = protocol.buildSendFrame(
+                        topic, event, protocol.getCurrentUsername(), filename, receiptId);
                     
-                    handler->sendFrameAscii(sendFrame, '\0');
+                    // a slow broker holds the report back here instead of growing the queue
+                    if (!handler.queueFrameWithBackpressure(std::move(sendFrame), '\0'))
+                        break; // connection lost
                     
-                    handler->getProtocol().saveGameEvent(handler->getProtocol().getCurrentUsername(), gameName, event);
+                    protocol.saveGameEvent(protocol.getCurrentUsername(), gameName, event);
+                }
+
+                if (window != nullptr) {
+                    bool confirmed = window->waitAll();
+                    printReportStats(window->getStats(), confirmed, nae.events.size());
                 }
-              
+                if (bucket != nullptr)
+                    printPacingStats(*bucket);
+                printBackpressureStats(handler.getOutboundStats());
+                printCompressionStats(compressionBefore, protocol.getCompressionStats());
 
             } catch (const std::exception& e) {
                 // Cattura sia file non trovato che errori JSON
@@ -207,34 +639,66 @@ int main(int argc, char* argv[]) {
                 continue;
             }
             // Delegate logic to protocol (writes to file)
-            handler->getProtocol().generateSummary(tokens[1], tokens[2], tokens[3]);
+            pool->getProtocol().generateSummary(tokens[1], tokens[2], tokens[3]);
+        }
+        
+        // --- Command: STATS ---
+        else if (command == "stats") {
+            // frames, bytes, syscalls and blocked time of every connection
+            pool->printStats(cout);
         }
         
         // --- command: LOGOUT ---
         else if (command == "logout") {
-            //  send DISCONNECT frame
-             string frame = handler->getProtocol().buildDisconnectFrame();
-            handler->sendFrameAscii(frame, '\0');
-            
             // mark as logged out internally
-            handler->getProtocol().setLoggedIn(false);
+            pool->getProtocol().setLoggedIn(false);
+
+            // frames of a report that did not drain yet: DISCONNECT queues behind them
+            // (the broker drops whatever arrives after it), so they are sent first
+            size_t pending = 0;
+            unsigned long long droppedBefore = 0;
+            for (size_t i = 0; i < pool->size(); i++) {
+                pending += pool->at(i).getOutboundStats().queuedFrames;
+                droppedBefore += pool->at(i).getIoStats().framesDropped;
+            }
+            if (pending > 0)
+                cout << "Sending " << pending << " queued frames before DISCONNECT" << endl;
+
+            //  send DISCONNECT frame (every connection of the pool that still has a session)
+            for (size_t i = 0; i < pool->size(); i++) {
+                 string frame = pool->getProtocol().buildDisconnectFrame(pool->at(i).getConnectionId());
+                if (frame.empty())
+                    continue;
+                if (!pool->at(i).queueFinalFrame(std::move(frame), '\0')) {
+                    // no receipt will come from there
+                    cerr << "Could not send DISCONNECT: connection " << i << " is down" << endl;
+                    pool->getProtocol().connectionLost(pool->at(i).getConnectionId());
+                }
+            }
 
             //  wait for logout to complete (wait for receipt)    
-             handler->getProtocol().waitForLogout(); 
+             pool->getProtocol().waitForLogout(); 
+
+            // only a connection that went down while they were queued loses frames
+            unsigned long long dropped = 0;
+            for (size_t i = 0; i < pool->size(); i++)
+                dropped += pool->at(i).getIoStats().framesDropped;
+            if (dropped > droppedBefore)
+                cout << dropped - droppedBefore << " queued frames were discarded" << endl;
             
             //  close resources
-            handler->close(); // This will cause socketReaderThread to exit its loop
+            pool->close(); // This will cause socketReaderThread to exit its loop
             
             //closing the reader thread will also exit the loop
-            // wait for the reader thread to finish
-            if (readerThread != nullptr) {
-                readerThread->join(); // wait for the thread to finish and die
-                delete readerThread;
-                readerThread = nullptr;
+            // wait for the reader threads to finish
+            for (thread* t : readerThreads) {
+                t->join(); // wait for the thread to finish and die
+                delete t;
             }
-            // finally delete the connection handler
-            delete handler;
-            handler = nullptr;
+            readerThreads.clear();
+            // finally delete the connections
+            delete pool;
+            pool = nullptr;
             
              cout << "Logged out" <<  endl;
         }
@@ -245,14 +709,8 @@ int main(int argc, char* argv[]) {
     
     // --- Cleanup (if user pressed Ctrl+C or input ended without logout)  
     // make sure we close the connection and join the thread
-    if (handler != nullptr) {
-        handler->close();
-        if (readerThread != nullptr) {
-            readerThread->join();
-            delete readerThread;
-        }
-        delete handler;
-    }
+    if (pool != nullptr)
+        closePool(pool, readerThreads); // no auto-reconnect from here on
     
     return 0;
 }
\ No newline at end of file
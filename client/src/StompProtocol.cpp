@@ -1,5 +1,8 @@
 #include "StompProtocol.h"
+#include "DeflateCodec.h"
+#include "FrameWriter.h"
 #include <fstream>
+#include <chrono>
 #include <iostream>
 #include <algorithm>
 #include <vector>
@@ -9,7 +12,9 @@ using namespace std;
 //initializes the protocol state and counters
 StompProtocol::StompProtocol() 
     : username(""), password(""), receiptIdCounter(0), 
-      subscriptionIdCounter(0), loggedIn(false) {}
+      subscriptionIdCounter(0), heartBeatSendMs(0), heartBeatReceiveMs(0),
+      compressThreshold(0), compressionAccepted(false), resubscribePending(), loggedIn(false),
+      failedConnection(-1), subscriptionConnections(), expectedReceiptIds(), liveConnections(), compressionStats(), windowMutex(), reportWindow(nullptr), reportConnection(0) {}
 
 //ID Generation Helpers
 
@@ -25,25 +30,130 @@ string StompProtocol::generateSubscriptionId() {
 
 // Frame Builders 
 
+// shared by buildSubscribeFrame and the replay after a reconnect
+static string writeSubscribeFrame(const string& topic, const string& subId, const string& receiptId) {
+    return writeExact([&](FrameWriter& frame) {
+        frame.append("SUBSCRIBE\n");
+        frame.line("destination:", topic);
+        frame.line("id:", subId);
+        frame.line("receipt:", receiptId);
+        frame.append('\n');
+    });
+}
+
 
 string StompProtocol::buildConnectFrame(const string& host, 
                                         const string& user, 
                                         const string& pass) {
-    username = user;
-    password = pass;
-    
+    {
+        // the reader thread reads them for reconnects, the main thread for reports
+        lock_guard<mutex> lock(mtx);
+        username = user;
+        password = pass;
+    }
+    return writeConnectFrame(user, pass);
+}
+
+// the CONNECT frame itself, from credentials the caller already holds
+string StompProtocol::writeConnectFrame(const string& user, const string& pass) const {
     // Building the frame 
-    string frame = "CONNECT\n";
-    frame += "accept-version:1.2\n";
-    frame += "host:stomp.cs.bgu.ac.il\n";
-    frame += "login:" + user + "\n";
-    frame += "passcode:" + pass + "\n";
-    frame += "\n"; // Empty line marks end of headers
-    
-    return frame;
+    return writeExact([&](FrameWriter& frame) {
+        frame.append("CONNECT\n");
+        frame.append("accept-version:1.2\n");
+        frame.append("host:stomp.cs.bgu.ac.il\n");
+        frame.line("login:", user);
+        frame.line("passcode:", pass);
+        frame.append("heart-beat:").appendNumber(heartBeatSendMs).append(',')
+             .appendNumber(heartBeatReceiveMs).append('\n');
+        if (compressThreshold > 0)
+            frame.append("accept-encoding:deflate\n");
+        frame.append('\n'); // Empty line marks end of headers
+    });
+}
+
+string StompProtocol::buildReconnectFrame(int connectionId) {
+    string user, pass;
+    {
+        lock_guard<mutex> lock(mtx);
+        resubscribePending.insert(connectionId);
+        user = username;
+        pass = password;
+    }
+    return writeConnectFrame(user, pass);
+}
+
+// the broker forgot our subscriptions with the old connection, so they are replayed
+// with their original ids: the subscriptions map and the game reports stay as they are
+vector<string> StompProtocol::buildResubscribeFrames(int connectionId) {
+    vector<pair<string, string>> active;
+    {
+        lock_guard<mutex> lock(mtx);
+        if (resubscribePending.erase(connectionId) == 0)
+            return vector<string>();
+        for (auto& sub : subscriptions) {
+            if (subscriptionConnections[sub.first] == connectionId)
+                active.push_back(sub);
+        }
+    }
+
+    vector<string> frames;
+    frames.reserve(active.size());
+    for (auto& sub : active)
+        frames.push_back(writeSubscribeFrame(sub.second, sub.first, generateReceiptId()));
+    return frames;
+}
+
+void StompProtocol::setHeartBeat(int sendEveryMs, int receiveEveryMs) {
+    heartBeatSendMs = sendEveryMs > 0 ? sendEveryMs : 0;
+    heartBeatReceiveMs = receiveEveryMs > 0 ? receiveEveryMs : 0;
+}
+
+// STOMP 1.2: with "heart-beat:cx,cy" sent and "heart-beat:sx,sy" received, we send every
+// max(cx, sy) ms and expect something every max(cy, sx) ms; a 0 on either side turns it off.
+void StompProtocol::negotiateHeartBeat(const FrameView& connectedFrame, int& sendEveryMs, int& expectEveryMs) const {
+    sendEveryMs = 0;
+    expectEveryMs = 0;
+
+    if (!connectedFrame.hasHeader(FrameView::HeartBeat))
+        return;
+
+    int serverSend = 0, serverReceive = 0;
+    try {
+        string value = connectedFrame.header(FrameView::HeartBeat).str();
+        size_t comma = value.find(',');
+        if (comma == string::npos)
+            return;
+        serverSend = stoi(value.substr(0, comma));
+        serverReceive = stoi(value.substr(comma + 1));
+    } catch (...) {
+        return; // malformed header: no heart-beating
+    }
+
+    if (heartBeatSendMs > 0 && serverReceive > 0)
+        sendEveryMs = max(heartBeatSendMs, serverReceive);
+    if (heartBeatReceiveMs > 0 && serverSend > 0)
+        expectEveryMs = max(heartBeatReceiveMs, serverSend);
+}
+
+// the broker confirms with its own accept-encoding header; one that does not know the
+// header (or would re-encode the body as text) never sees a deflated SEND.
+void StompProtocol::negotiateCompression(const FrameView& connectedFrame) {
+    StringView accepted = connectedFrame.header(FrameView::AcceptEncoding);
+    bool deflate = false;
+    size_t start = 0;
+    while (start <= accepted.size) {
+        size_t comma = accepted.find(',', start);
+        StringView encoding = accepted.substr(start, comma == StringView::npos ? StringView::npos : comma - start);
+        if (encoding == "deflate")
+            deflate = true;
+        if (comma == StringView::npos)
+            break;
+        start = comma + 1;
+    }
+    compressionAccepted = compressThreshold > 0 && deflate;
 }
 
-string StompProtocol::buildSubscribeFrame(const string& topic) {
+string StompProtocol::buildSubscribeFrame(const string& topic, int connectionId) {
     string subId = generateSubscriptionId();
     string receiptId = generateReceiptId();
     
@@ -51,29 +161,27 @@ string StompProtocol::buildSubscribeFrame(const string& topic) {
     {
         lock_guard<mutex> lock(mtx);
         subscriptions[subId] = topic;
+        subscriptionConnections[subId] = connectionId;
     }
     
-    string frame = "SUBSCRIBE\n";
-    frame += "destination:" + topic + "\n";
-    frame += "id:" + subId + "\n";
-    frame += "receipt:" + receiptId + "\n";
-    frame += "\n";
-    
-    return frame;
+    return writeSubscribeFrame(topic, subId, receiptId);
 }
 
 string StompProtocol::buildUnsubscribeFrame(const string& subId) {
     string receiptId = generateReceiptId();
     
-    string frame = "UNSUBSCRIBE\n";
-    frame += "id:" + subId + "\n";
-    frame += "receipt:" + receiptId + "\n";
-    frame += "\n";
+    string frame = writeExact([&](FrameWriter& writer) {
+        writer.append("UNSUBSCRIBE\n");
+        writer.line("id:", subId);
+        writer.line("receipt:", receiptId);
+        writer.append('\n');
+    });
     
     // remove the subscription from our local map
     {
         lock_guard<mutex> lock(mtx);
         subscriptions.erase(subId);
+        subscriptionConnections.erase(subId);
     }
     
     return frame;
@@ -81,166 +189,132 @@ string StompProtocol::buildUnsubscribeFrame(const string& subId) {
 
 string StompProtocol::buildSendFrame(const string& topic, 
                                      const Event& event, 
-                                     const string& user,  const string& filename) {
-    string frame = "SEND\n";
-    frame += "destination:" + topic + "\n";
-   
-    
+                                     const string& user,  const string& filename,
+                                     const string& receiptId) {
+    // Body (Assignment format). Counted first so its size can go in content-length, then
+    // written straight into the frame: no separate body string unless it is deflated
+    auto writeBody = [&](FrameWriter& writer) {
+        writer.line("user: ", user);
+        writer.line("team a: ", event.get_team_a_name());
+        writer.line("team b: ", event.get_team_b_name());
+        writer.line("event name: ", event.get_name());
+        writer.append("time: ").appendNumber(event.get_time()).append('\n');
+        
+        // add General Updates
+        writer.append("general game updates:\n");
+        for (auto& kv : event.get_game_updates())
+            writer.append(kv.first).append(": ").append(kv.second).append('\n');
+        
+        // add Team A Updates
+        writer.append("team a updates:\n");
+        for (auto& kv : event.get_team_a_updates())
+            writer.append(kv.first).append(": ").append(kv.second).append('\n');
+        
+        // add Team B Updates
+        writer.append("team b updates:\n");
+        for (auto& kv : event.get_team_b_updates())
+            writer.append(kv.first).append(": ").append(kv.second).append('\n');
+        
+        // Add Description
+        writer.append("description:\n").line("", event.get_discription());
+    };
+    FrameWriter bodyCounter(nullptr);
+    writeBody(bodyCounter);
+    size_t bodySize = bodyCounter.size();
 
-    // Optional: Include filename if available (not in Event class,
-    if (!filename.empty()) {
-        frame += "file-name:" + filename + "\n";
-    }
-    
-    frame += "\n"; // end of Headers
-
-    // start of Body (Assignment format)
-    frame += "user: " + user + "\n";
-    frame += "team a: " + event.get_team_a_name() + "\n";
-    frame += "team b: " + event.get_team_b_name() + "\n";
-    frame += "event name: " + event.get_name() + "\n";
-    frame += "time: " + to_string(event.get_time()) + "\n";
-    
-    // add General Updates
-    frame += "general game updates:\n";
-    for (auto& kv : event.get_game_updates()) {
-        frame += kv.first + ": " + kv.second + "\n";
-    }
-    
-    // add Team A Updates
-    frame += "team a updates:\n";
-    for (auto& kv : event.get_team_a_updates()) {
-        frame += kv.first + ": " + kv.second + "\n";
-    }
-    
-    // add Team B Updates
-    frame += "team b updates:\n";
-    for (auto& kv : event.get_team_b_updates()) {
-        frame += kv.first + ": " + kv.second + "\n";
+    // long descriptions make up most of the body: deflate it when the broker agreed,
+    // and keep the plain text if compression did not make it smaller
+    bool deflated = false;
+    string compressed;
+    if (compressionAccepted && bodySize >= compressThreshold) {
+        string body = writeExact(writeBody);
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        if (DeflateCodec::compress(body, compressed) && compressed.size() < body.size()) {
+            compressionStats.bodies++;
+            compressionStats.rawBytes += body.size();
+            compressionStats.compressedBytes += compressed.size();
+            bodySize = compressed.size();
+            deflated = true;
+        }
+        compressionStats.deflateMs += chrono::duration_cast<chrono::duration<double, milli>>(
+            chrono::steady_clock::now() - start).count();
     }
-    
-    // Add Description
-    frame += "description:\n" + event.get_discription() + "\n";
-    
-    return frame;
+
+    return writeExact([&](FrameWriter& frame) {
+        frame.append("SEND\n");
+        frame.line("destination:", topic);
+        if (!receiptId.empty())
+            frame.line("receipt:", receiptId);
+
+        // Optional: Include filename if available (not in Event class,
+        if (!filename.empty())
+            frame.line("file-name:", filename);
+
+        if (deflated)
+            frame.append("content-encoding:deflate\n");
+        // the receiver reads exactly this many body bytes instead of scanning for the '\0'
+        frame.append("content-length:").appendNumber(bodySize).append('\n');
+        
+        frame.append('\n'); // end of Headers
+        if (deflated)
+            frame.append(compressed);
+        else
+            writeBody(frame);
+    });
 }
 
-string StompProtocol::buildDisconnectFrame() {
+string StompProtocol::buildDisconnectFrame(int connectionId) {
     string receiptId = generateReceiptId();
     
     // --- LOGOUT TRACKING SETUP ---
+    // checked and registered under logoutMutex, so a connectionLost either came first
+    // (nothing registered) or removes the receipt again
     {
         lock_guard<mutex> lock(logoutMutex);
-        expectedReceiptId = receiptId;
-        isLogoutComplete = false;
+        if (liveConnections.count(connectionId) == 0)
+            return "";
+        expectedReceiptIds[receiptId] = connectionId;
     }
     // --------------------------------
     
-    string frame = "DISCONNECT\n";
-    frame += "receipt:" + receiptId + "\n";
-    frame += "\n";
-    
-    return frame;
+    return writeExact([&](FrameWriter& frame) {
+        frame.append("DISCONNECT\n");
+        frame.line("receipt:", receiptId);
+        frame.append('\n');
+    });
 }
 //frame procceing logic
 
-void StompProtocol::handleMessageFrame(const string& frame) {
-    // Variables to store parsed data
-    string user, teamA, teamB, eventName, description;
-    int time = 0;
-    map<string, string> gameUpdates, teamAUpdates, teamBUpdates;
-    
-    string section = ""; // tracks if we are in "general", "team a", or "description"
-    bool inBody = false; // tracks if we passed the headers
-    
-    // manual line splitting using string::find
-    size_t startPos = 0;
-    size_t endPos = frame.find('\n');
-    
-    //until we reach the end of the frame - >endPos != no position
-    while (endPos != string::npos) {
-        // Extract the current line
-        string line = frame.substr(startPos, endPos - startPos);
-        
-        // --- FIX FOR \r (Carriage Return) ---
-        // Windows/Network lines often end in \r\n. We must remove \r 
-        // otherwise comparisons like (line == "description:") will fail.
-        if (!line.empty() && line.back() == '\r') {
-            line.pop_back();
-        }
-        
-        // --- HEADER SKIP LOGIC ---
-        // The body starts after the first empty line.
-        if (!inBody) {
-            if (line.empty()) {
-                inBody = true; // Found the empty line, Body starts next
-            }
-            // Move to next line
-            startPos = endPos + 1;
-            endPos = frame.find('\n', startPos);
-            continue; 
-        }
-        
-        // --- BODY PARSING LOGIC ---
-        
-        //  data Fields
-        if (line.find("user: ") == 0) user = line.substr(6);
-        else if (line.find("team a: ") == 0) teamA = line.substr(8);
-        else if (line.find("team b: ") == 0) teamB = line.substr(8);
-        else if (line.find("event name: ") == 0) eventName = line.substr(12);
-        else if (line.find("time: ") == 0) {
-            try { time = stoi(line.substr(6)); } catch (...) { time = 0; }
-        }
-        
-        // Section Detection
-        else if (line == "general game updates:") section = "general";
-        else if (line == "team a updates:") section = "team_a";
-        else if (line == "team b updates:") section = "team_b";
-        else if (line == "description:") {
-            section = "description";
-            // Once we hit description, everything else is the description text.
-            // We read until the end of the frame string manually.
-            if (endPos + 1 < frame.length()) {
-                description = frame.substr(endPos + 1);
-                // Clean \r from description if needed (optional but good practice)
-                // Note: This takes the rest of the frame as description.
-            }
-            break; // Stop loop, we handled the rest as description
+void StompProtocol::handleMessageFrame(const FrameView& frame) {
+    // the event keeps one copy of the body and an index into it; the update maps are only
+    // built if a summary asks for them
+    StringView encoding = frame.header(FrameView::ContentEncoding);
+    string body;
+    if (encoding == "deflate") {
+        // a deflated body is inflated first, to no more than a frame may carry
+        if (!DeflateCodec::decompress(frame.body.data, frame.body.size, body, FrameView::MAX_FRAME_SIZE)) {
+            cerr << "Dropped MESSAGE: body is not valid deflate data or inflates past "
+                 << FrameView::MAX_FRAME_SIZE << " bytes" << endl;
+            return;
         }
-        
-        // 3. Key-Value Parsing (inside a section)
-        else if (!line.empty()) {
-            size_t colonPos = line.find(':');
-            if (colonPos != string::npos) {
-                string key = line.substr(0, colonPos);
-                string value = line.substr(colonPos + 1);
-                
-                // Trim leading space from value
-                if (!value.empty() && value[0] == ' ') value = value.substr(1);
-                
-                if (section == "general") gameUpdates[key] = value;
-                else if (section == "team_a") teamAUpdates[key] = value;
-                else if (section == "team_b") teamBUpdates[key] = value;
-            }
-        }
-        
-        // Move to next line
-        startPos = endPos + 1;
-        endPos = frame.find('\n', startPos);
+    } else if (!encoding.empty() && encoding != "identity") {
+        cerr << "Dropped MESSAGE: unsupported content-encoding " << encoding << endl;
+        return;
+    } else {
+        body = frame.body.str();
     }
+    Event event(body);
     
     // save and display
-    string gameName = teamA + "_" + teamB;
-    Event event(teamA, teamB, eventName, time, 
-                gameUpdates, teamAUpdates, teamBUpdates, description);
+    string gameName = event.get_team_a_name() + "_" + event.get_team_b_name();
     
-    saveGameEvent(user, gameName, event);
+    saveGameEvent(event.get_user(), gameName, event);
     
     // Output to console
-    cout << "Displaying update from user: " << user << "\n";
+    cout << "Displaying update from user: " << event.get_user() << "\n";
     cout << "Game: " << gameName << "\n";
-    cout << "Event: " << eventName << "\n";
-    cout << description << "\n" << endl;
+    cout << "Event: " << event.get_name() << "\n";
+    cout << event.get_discription() << "\n" << endl;
 }
 
 // data Management: Saves the event to the map
@@ -264,6 +338,9 @@ void StompProtocol::saveGameEvent(const string& user,
 void StompProtocol::generateSummary(const string& gameName, 
                                     const string& user, 
                                     const string& outputFile) {
+    // the reader thread may be adding events, and reading an event decodes it in place
+    lock_guard<mutex> lock(mtx);
+
     // Check if data exists
     if (gameReports.find(user) == gameReports.end() || 
         gameReports[user].find(gameName) == gameReports[user].end()) {
@@ -316,6 +393,11 @@ void StompProtocol::generateSummary(const string& gameName,
     cout << "Summary written to " << outputFile << endl;
 }
 
+string StompProtocol::getCurrentUsername() {
+    lock_guard<mutex> lock(mtx);
+    return username;
+}
+
 // Utility: Find Subscription ID by Topic
 string StompProtocol::getSubscriptionIdByTopic(const string& topic) {
     lock_guard<mutex> lock(mtx);
@@ -332,19 +414,60 @@ string StompProtocol::getSubscriptionIdByTopic(const string& topic) {
 // Waits for logout to complete
 void StompProtocol::waitForLogout() {
     unique_lock<mutex> lock(logoutMutex);
-   //wait until isLogoutComplete is true
-    logoutCv.wait(lock, [this] { return isLogoutComplete; });
+   //wait until no receipt is missing any more
+    logoutCv.wait(lock, [this] { return expectedReceiptIds.empty(); });
 }
 
 //RECEIPT processing for logout
 bool StompProtocol::processLogoutReceipt(const string& receiptId) {
     lock_guard<mutex> lock(logoutMutex);
     
-    // Check if this receipt ID matches the expected logout receipt ID
-    if (!expectedReceiptId.empty() && receiptId == expectedReceiptId) {
-        isLogoutComplete = true; // set the flag we are done
-        logoutCv.notify_all();   // notify waiting threads
+    // Check if this receipt ID matches one of the expected logout receipt IDs
+    if (expectedReceiptIds.erase(receiptId) == 0)
+        return false;
+    if (expectedReceiptIds.empty())
+        logoutCv.notify_all();   // notify waiting threads (every connection answered)
+    return true;
+}
+
+// registers (or clears, with nullptr) the window of the report being published
+void StompProtocol::setReportWindow(ReceiptWindow* window, int connectionId) {
+    lock_guard<mutex> lock(windowMutex);
+    reportWindow = window;
+    reportConnection = connectionId;
+}
+
+//RECEIPT processing: the logout receipt first, otherwise it may acknowledge a report SEND
+bool StompProtocol::processReceipt(const string& receiptId) {
+    if (processLogoutReceipt(receiptId))
         return true;
+
+    lock_guard<mutex> lock(windowMutex);
+    return reportWindow != nullptr && reportWindow->acknowledge(receiptId);
+}
+
+void StompProtocol::connectionEstablished(int connectionId) {
+    lock_guard<mutex> lock(logoutMutex);
+    liveConnections.insert(connectionId);
+}
+
+// connection closed or ERROR: a report sending on it would wait forever for its receipts,
+// and so would a logout waiting for this connection's DISCONNECT receipt. A report on
+// another connection of the pool is not affected and keeps going.
+void StompProtocol::connectionLost(int connectionId) {
+    {
+        lock_guard<mutex> lock(windowMutex);
+        if (reportWindow != nullptr && reportConnection == connectionId)
+            reportWindow->abort();
+    }
+    lock_guard<mutex> lock(logoutMutex);
+    liveConnections.erase(connectionId);
+    for (auto it = expectedReceiptIds.begin(); it != expectedReceiptIds.end();) {
+        if (it->second == connectionId)
+            it = expectedReceiptIds.erase(it);
+        else
+            ++it;
     }
-    return false;
+    if (expectedReceiptIds.empty())
+        logoutCv.notify_all();
 }
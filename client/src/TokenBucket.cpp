@@ -0,0 +1,43 @@
+#include "../include/TokenBucket.h"
+#include <algorithm>
+#include <thread>
+
+TokenBucket::TokenBucket(double ratePerSecond, size_t burst)
+    : rate_(ratePerSecond), burst_(burst == 0 ? 1 : burst), tokens_(burst_), last_(), start_(),
+      started_(false), stats_() {}
+
+void TokenBucket::refill(Clock::time_point now) {
+    std::chrono::duration<double> elapsed = now - last_;
+    tokens_ = std::min(static_cast<double>(burst_), tokens_ + elapsed.count() * rate_);
+    last_ = now;
+}
+
+// the missing fraction of a token tells exactly when the next one is due; the sleep is one
+// sleep_until, and how late the thread woke up is the pacing jitter.
+void TokenBucket::acquire() {
+    Clock::time_point now = Clock::now();
+    if (!started_) {
+        started_ = true;
+        start_ = now;
+        last_ = now;
+    }
+    refill(now);
+
+    if (tokens_ < 1) {
+        std::chrono::duration<double> wait((1 - tokens_) / rate_);
+        Clock::time_point due = now + std::chrono::duration_cast<Clock::duration>(wait);
+        std::this_thread::sleep_until(due);
+        now = Clock::now();
+        refill(now);
+        tokens_ = std::max(tokens_, 1.0); // rounding of the due time must not leave us short
+
+        Clock::duration lateness = now - due;
+        stats_.delayed++;
+        stats_.totalLateness += lateness;
+        stats_.maxLateness = std::max(stats_.maxLateness, lateness);
+    }
+
+    tokens_ -= 1;
+    stats_.granted++;
+    stats_.elapsed = now - start_;
+}
@@ -0,0 +1,173 @@
+#include "../include/UringTransport.h"
+
+#include <cerrno>
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// there is no liburing dependency, the three system calls are used directly
+static int ioUringSetup(unsigned entries, io_uring_params *params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int ioUringEnter(int fd, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+static int ioUringRegister(int fd, unsigned opcode, const void *arg, unsigned nrArgs) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nrArgs));
+}
+#endif
+
+// ring depth: one operation is in flight at a time (see UringTransport.h), the
+// extra entries only cost a few bytes of the page the rings are mapped into
+static const unsigned RING_ENTRIES = 4;
+
+UringTransport::UringTransport()
+    : ringFd_(-1), socketFd_(-1), buffer_(nullptr), sqRing_(nullptr), cqRing_(nullptr), sqes_(nullptr),
+      sqRingSize_(0), cqRingSize_(0), sqesSize_(0), sqHead_(nullptr), sqTail_(nullptr), sqMask_(nullptr),
+      sqArray_(nullptr), cqHead_(nullptr), cqTail_(nullptr), cqMask_(nullptr), cqes_(nullptr) {}
+
+UringTransport::~UringTransport() {
+#ifdef __linux__
+    if (sqes_ != nullptr)
+        munmap(sqes_, sqesSize_);
+    if (cqRing_ != nullptr && cqRing_ != sqRing_)
+        munmap(cqRing_, cqRingSize_);
+    if (sqRing_ != nullptr)
+        munmap(sqRing_, sqRingSize_);
+    if (ringFd_ >= 0)
+        ::close(ringFd_);   // also unregisters the buffer
+#endif
+}
+
+#ifdef __linux__
+
+bool UringTransport::init(int fd, char *buffer, size_t size) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ringFd_ = ioUringSetup(RING_ENTRIES, &params);
+    if (ringFd_ < 0)
+        return false;
+
+    // map the submission queue, the completion queue and the SQE array
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool singleMmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMmap) {
+        if (cqRingSize_ > sqRingSize_)
+            sqRingSize_ = cqRingSize_;
+        cqRingSize_ = sqRingSize_;
+    }
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   ringFd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        sqRing_ = nullptr;
+        return false;
+    }
+    if (singleMmap) {
+        cqRing_ = sqRing_;
+    } else {
+        cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ringFd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            cqRing_ = nullptr;
+            return false;
+        }
+    }
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                 ringFd_, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED) {
+        sqes_ = nullptr;
+        return false;
+    }
+
+    char *sq = static_cast<char *>(sqRing_);
+    char *cq = static_cast<char *>(cqRing_);
+    sqHead_ = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    sqMask_ = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    sqArray_ = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    cqHead_ = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    cqMask_ = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    cqes_ = cq + params.cq_off.cqes;
+
+    // pin the buffer once so fixed reads/writes skip the per-call page mapping
+    iovec registered;
+    registered.iov_base = buffer;
+    registered.iov_len = size;
+    if (ioUringRegister(ringFd_, IORING_REGISTER_BUFFERS, &registered, 1) < 0)
+        return false;
+
+    socketFd_ = fd;
+    buffer_ = buffer;
+    return true;
+}
+
+ssize_t UringTransport::submitAndWait(unsigned char opcode, size_t offset, size_t length) {
+    unsigned tail = *sqTail_;
+    unsigned index = tail & *sqMask_;
+    io_uring_sqe *sqe = static_cast<io_uring_sqe *>(sqes_) + index;
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = socketFd_;
+    sqe->addr = reinterpret_cast<unsigned long>(buffer_ + offset);
+    sqe->len = static_cast<unsigned>(length);
+    sqe->buf_index = 0;
+    sqArray_[index] = index;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+
+    // submit and wait for the completion in the same system call
+    int submitted;
+    do {
+        submitted = ioUringEnter(ringFd_, 1, 1, IORING_ENTER_GETEVENTS);
+    } while (submitted < 0 && errno == EINTR);
+    if (submitted < 0)
+        return -errno;
+
+    unsigned head = *cqHead_;
+    while (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+        // interrupted before the completion was posted
+        if (ioUringEnter(ringFd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR)
+            return -errno;
+    }
+    io_uring_cqe *cqe = static_cast<io_uring_cqe *>(cqes_) + (head & *cqMask_);
+    ssize_t result = cqe->res;
+    __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+    return result;
+}
+
+ssize_t UringTransport::readFixed(size_t offset, size_t length) {
+    return submitAndWait(IORING_OP_READ_FIXED, offset, length);
+}
+
+ssize_t UringTransport::writeFixed(size_t offset, size_t length) {
+    return submitAndWait(IORING_OP_WRITE_FIXED, offset, length);
+}
+
+#else
+
+bool UringTransport::init(int, char *, size_t) {
+    return false;
+}
+
+ssize_t UringTransport::submitAndWait(unsigned char, size_t, size_t) {
+    return -ENOSYS;
+}
+
+ssize_t UringTransport::readFixed(size_t, size_t) {
+    return -ENOSYS;
+}
+
+ssize_t UringTransport::writeFixed(size_t, size_t) {
+    return -ENOSYS;
+}
+
+#endif
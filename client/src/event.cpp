@@ -1,5 +1,6 @@
 #include "../include/event.h"
 #include "../include/json.hpp"
+#include "../include/FrameView.h"
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -13,7 +14,9 @@ Event::Event(std::string team_a_name, std::string team_b_name, std::string name,
              std::map<std::string, std::string> team_b_updates, std::string discription)
     : team_a_name(team_a_name), team_b_name(team_b_name), name(name),
       time(time), game_updates(game_updates), team_a_updates(team_a_updates),
-      team_b_updates(team_b_updates), description(discription)
+      team_b_updates(team_b_updates), description(discription), body(), user_span(),
+      team_a_span(), team_b_span(), name_span(), time_span(), description_span(),
+      update_lines(), decoded(ALL_PARTS), user("")
 {
 }
 
@@ -23,46 +26,179 @@ Event::~Event()
 
 const std::string &Event::get_team_a_name() const
 {
-    return this->team_a_name;
+    return decode_string(TEAM_A, team_a_span, this->team_a_name);
 }
 
 const std::string &Event::get_team_b_name() const
 {
-    return this->team_b_name;
+    return decode_string(TEAM_B, team_b_span, this->team_b_name);
 }
 
 const std::string &Event::get_name() const
 {
-    return this->name;
+    return decode_string(NAME, name_span, this->name);
 }
 
 int Event::get_time() const
 {
+    if (!(decoded & TIME))
+    {
+        try { this->time = std::stoi(body.substr(time_span.begin, time_span.length)); } catch (...) { this->time = 0; }
+        decoded |= TIME;
+    }
     return this->time;
 }
 
 const std::map<std::string, std::string> &Event::get_game_updates() const
 {
-    return this->game_updates;
+    return decode_updates(GAME_UPDATES, this->game_updates);
 }
 
 const std::map<std::string, std::string> &Event::get_team_a_updates() const
 {
-    return this->team_a_updates;
+    return decode_updates(TEAM_A_UPDATES, this->team_a_updates);
 }
 
 const std::map<std::string, std::string> &Event::get_team_b_updates() const
 {
-    return this->team_b_updates;
+    return decode_updates(TEAM_B_UPDATES, this->team_b_updates);
 }
 
 const std::string &Event::get_discription() const
 {
-    return this->description;
+    return decode_string(DESCRIPTION, description_span, this->description);
+}
+
+const std::string &Event::get_user() const
+{
+    return decode_string(USER, user_span, this->user);
+}
+
+namespace
+{
+// the lines of a MESSAGE body the parser treats specially
+enum BodyLine
+{
+    UserField, TeamAField, TeamBField, EventNameField, TimeField,
+    GeneralHeader, TeamAHeader, TeamBHeader, DescriptionHeader, OtherLine
+};
+
+// "key: value" is a field, "key:" with nothing after the colon starts a section.
+// Plain compares: most keys differ from the candidates in their first byte, which is
+// cheaper than hashing the whole key (bench/KeyDispatchBench.cpp)
+BodyLine classifyBodyLine(const StringView &key, const StringView &value, bool hasColon)
+{
+    if (value.startsWith(" "))
+    {
+        if (key == "user") return UserField;
+        if (key == "team a") return TeamAField;
+        if (key == "team b") return TeamBField;
+        if (key == "event name") return EventNameField;
+        if (key == "time") return TimeField;
+    }
+    else if (hasColon && value.empty())
+    {
+        if (key == "general game updates") return GeneralHeader;
+        if (key == "team a updates") return TeamAHeader;
+        if (key == "team b updates") return TeamBHeader;
+        if (key == "description") return DescriptionHeader;
+    }
+    return OtherLine;
+}
+} // namespace
+
+Event::Event(const std::string &frame_body)
+    : team_a_name(""), team_b_name(""), name(""), time(0), game_updates(), team_a_updates(),
+      team_b_updates(), description(""), body(frame_body), user_span(), team_a_span(),
+      team_b_span(), name_span(), time_span(), description_span(), update_lines(), decoded(0), user("")
+{
+    index_body();
+}
+
+// one pass over the body that only records offsets: a field value, every update line of a
+// section and the start of the description. Lines must end in '\n', a '\r' before it is dropped.
+void Event::index_body()
+{
+    StringView text(body.data(), body.size());
+    auto span_of = [&text](const StringView &part) -> Span {
+        Span span = {static_cast<uint32_t>(part.data - text.data), static_cast<uint32_t>(part.size)};
+        return span;
+    };
+
+    // lines are short, memchr (StringView::find) finds their ends faster than an index of the
+    // whole body could be built (see bench/MessageParseBench.cpp)
+    uint8_t section = 0; // no section yet: "key: value" lines are not updates
+    size_t startPos = 0;
+    size_t endPos = text.find('\n');
+    while (endPos != StringView::npos)
+    {
+        StringView line = text.substr(startPos, endPos - startPos);
+        if (!line.empty() && line.back() == '\r')
+            line.size--;
+
+        // the key is everything before the first ':' (the whole line if there is none)
+        size_t colonPos = line.find(':');
+        StringView key = line.substr(0, colonPos);
+        StringView value = colonPos == StringView::npos ? StringView() : line.substr(colonPos + 1);
+
+        BodyLine kind = classifyBodyLine(key, value, colonPos != StringView::npos);
+        if (kind == DescriptionHeader)
+        {
+            // everything after the description line is the description text
+            description_span = span_of(text.substr(endPos + 1));
+            break;
+        }
+        switch (kind)
+        {
+        case UserField: user_span = span_of(value.substr(1)); break;
+        case TeamAField: team_a_span = span_of(value.substr(1)); break;
+        case TeamBField: team_b_span = span_of(value.substr(1)); break;
+        case EventNameField: name_span = span_of(value.substr(1)); break;
+        case TimeField: time_span = span_of(value.substr(1)); break;
+        case GeneralHeader: section = GAME_UPDATES; break;
+        case TeamAHeader: section = TEAM_A_UPDATES; break;
+        case TeamBHeader: section = TEAM_B_UPDATES; break;
+        case OtherLine:
+            if (colonPos != StringView::npos && section != 0)
+            {
+                if (!value.empty() && value.data[0] == ' ')
+                    value = value.substr(1);
+                UpdateLine update = {span_of(key), span_of(value), section};
+                update_lines.push_back(update);
+            }
+            break;
+        default:
+            break;
+        }
+
+        startPos = endPos + 1;
+        endPos = text.find('\n', startPos);
+    }
 }
 
-Event::Event(const std::string &frame_body) : team_a_name(""), team_b_name(""), name(""), time(0), game_updates(), team_a_updates(), team_b_updates(), description("")
+const std::string &Event::decode_string(Part part, const Span &span, std::string &target) const
 {
+    if (!(decoded & part))
+    {
+        target.assign(body, span.begin, span.length);
+        decoded |= part;
+    }
+    return target;
+}
+
+// a key that appears twice in a section keeps the later value
+const std::map<std::string, std::string> &Event::decode_updates(Part part, std::map<std::string, std::string> &target) const
+{
+    if (!(decoded & part))
+    {
+        for (const UpdateLine &update : update_lines)
+        {
+            if (update.section == part)
+                target[body.substr(update.key.begin, update.key.length)] = body.substr(update.value.begin, update.value.length);
+        }
+        decoded |= part;
+    }
+    return target;
 }
 
 names_and_events parseEventsFile(std::string json_path)
@@ -0,0 +1,106 @@
+// Heap allocations on the send path, counted by a replaced global operator new (only on the
+// thread that builds and queues, so the writer thread does not blur the numbers).
+//  - buildSendFrame: the body is written into the frame in the same pass as the headers, so
+//    the frame string is allocated once, including room for the '\0' the queue appends.
+//  - queueing a moved frame: no copy of the frame; what is left are the queue's own blocks.
+// Exits non-zero if any check failed; unlike an assert this also runs in an -DNDEBUG build.
+#include "../include/ConnectionHandler.h"
+#include "../include/StompProtocol.h"
+#include "LoopbackBroker.h"
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+static std::atomic<size_t> allocations(0);
+static thread_local bool counting = false;
+
+void *operator new(size_t size) {
+    if (counting)
+        allocations++;
+    void *memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr)
+        throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+// number of heap allocations the calling thread makes in work()
+template <typename Work>
+static size_t countAllocations(Work work) {
+    allocations = 0;
+    counting = true;
+    work();
+    counting = false;
+    return allocations;
+}
+
+static void checkBuilders(StompProtocol &protocol, const names_and_events &report) {
+    std::cout << "frame builders:" << std::endl;
+    std::string topic = report.team_a_name + "_" + report.team_b_name;
+    size_t worst = 0, full = 0;
+    for (const Event &event : report.events) {
+        std::string frame;
+        size_t count = countAllocations([&] { frame = protocol.buildSendFrame(topic, event, "test", "events1.json"); });
+        worst = std::max(worst, count);
+        if (frame.capacity() == frame.size())
+            full++;
+    }
+    check(worst == 1, "buildSendFrame allocates once per frame (worst " + std::to_string(worst) + ")");
+    check(full == 0, "every SEND frame has room for the delimiter");
+
+    std::string frame;
+    size_t count = countAllocations([&] { frame = protocol.buildUnsubscribeFrame("17"); });
+    check(count == 1, "buildUnsubscribeFrame allocates once (" + std::to_string(count) + ")");
+}
+
+static void checkQueue(StompProtocol &protocol, const names_and_events &report) {
+    std::cout << "outbound queue:" << std::endl;
+    LoopbackBroker broker(LoopbackBroker::discard);
+    ConnectionHandler handler("127.0.0.1", broker.port(), IoMode::Blocking);
+    handler.setOutboundLimits(0, 0);
+    if (!handler.connect()) {
+        check(false, "connect to the test broker");
+        broker.abandon();
+        return;
+    }
+
+    std::string topic = report.team_a_name + "_" + report.team_b_name;
+    std::vector<std::string> frames;
+    for (int round = 0; round < 50; round++) {
+        for (const Event &event : report.events)
+            frames.push_back(protocol.buildSendFrame(topic, event, "test", "events1.json"));
+    }
+    size_t count = countAllocations([&] {
+        for (std::string &frame : frames)
+            handler.queueFrameWithBackpressure(std::move(frame), '\0');
+    });
+    // a copy per frame would be frames.size() allocations; the deque allocates a block now and then
+    check(count < frames.size() / 4, "queueing " + std::to_string(frames.size()) + " moved frames allocates " +
+          std::to_string(count) + " times");
+
+    while (handler.getOutboundStats().queuedFrames > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100)); // the last batch is still being written
+    handler.close();
+    broker.finish();
+}
+
+int main(int argc, char *argv[]) {
+    std::string file = argc > 1 ? argv[1] : "data/events1.json";
+    names_and_events report = parseEventsFile(file);
+    if (report.events.empty()) {
+        std::cerr << "no events in " << file << std::endl;
+        return 1;
+    }
+    StompProtocol protocol;
+    checkBuilders(protocol, report);
+    checkQueue(protocol, report);
+    return checkSummary();
+}
@@ -0,0 +1,64 @@
+// Broker ports from 32768 up (the upper half of the range, negative as a short): both the
+// blocking connect and the async reconnect go through the resolver for a host name, whose
+// service string has to be the port as written. Exits non-zero if any check failed.
+#include "../include/ConnectionHandler.h"
+#include "LoopbackBroker.h"
+#include <memory>
+#include <string>
+
+// a broker on the first free port from 'first' up
+static std::unique_ptr<LoopbackBroker> brokerFrom(unsigned short first) {
+    for (unsigned port = first; port < first + 100u; port++) {
+        try {
+            return std::unique_ptr<LoopbackBroker>(new LoopbackBroker(LoopbackBroker::discard, 0, port));
+        } catch (const boost::system::system_error &) {
+            // taken, try the next one
+        }
+    }
+    return std::unique_ptr<LoopbackBroker>();
+}
+
+static void blockingConnect(unsigned short first) {
+    std::unique_ptr<LoopbackBroker> broker = brokerFrom(first);
+    if (!broker) {
+        check(false, "no free port from " + std::to_string(first));
+        return;
+    }
+    ConnectionHandler handler("localhost", broker->port());
+    bool connected = handler.connect();
+    check(connected, "blocking connect to localhost:" + std::to_string(broker->port()));
+    if (!connected) {
+        broker->abandon();
+        return;
+    }
+    handler.close();
+    broker->finish();
+}
+
+static void asyncReconnect(unsigned short first) {
+    std::unique_ptr<LoopbackBroker> broker = brokerFrom(first);
+    if (!broker) {
+        check(false, "no free port from " + std::to_string(first));
+        return;
+    }
+    ConnectionHandler handler("localhost", broker->port(), IoMode::Async);
+    bool connected = false;
+    handler.asyncReconnect([&handler, &connected](bool result) {
+        connected = result;
+        handler.close();
+    });
+    handler.getIoService().run();
+    check(connected, "async reconnect to localhost:" + std::to_string(broker->port()));
+    if (!connected) {
+        broker->abandon();
+        return;
+    }
+    broker->finish();
+}
+
+int main() {
+    blockingConnect(40000);
+    asyncReconnect(40100);
+    blockingConnect(65400);
+    return checkSummary();
+}
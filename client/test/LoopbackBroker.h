@@ -0,0 +1,98 @@
+#pragma once
+
+// Fixture shared by the programs in test/ and bench/: a broker stand-in on 127.0.0.1 that
+// accepts one connection on its own thread, and the check() helpers of the tests.
+#include <boost/asio.hpp>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// Accepts one connection and hands it to 'session' on the broker thread.
+// receiveBufferSize > 0 sets SO_RCVBUF on the listening socket (inherited by the connection),
+// to make a slow reader whose backlog stays on the client side. port 0 picks an ephemeral
+// one; a port that is taken throws boost::system::system_error.
+class LoopbackBroker {
+public:
+    typedef boost::asio::ip::tcp tcp;
+    typedef std::function<void(tcp::socket &)> Session;
+
+    explicit LoopbackBroker(Session session, int receiveBufferSize = 0, unsigned short port = 0)
+        : service_(), acceptor_(service_), session_(session), thread_() {
+        tcp::endpoint endpoint(boost::asio::ip::address::from_string("127.0.0.1"), port);
+        acceptor_.open(endpoint.protocol());
+        if (receiveBufferSize > 0)
+            acceptor_.set_option(boost::asio::socket_base::receive_buffer_size(receiveBufferSize));
+        acceptor_.bind(endpoint);
+        acceptor_.listen();
+        thread_ = std::thread(&LoopbackBroker::run, this);
+    }
+
+    ~LoopbackBroker() {
+        if (thread_.joinable())
+            thread_.join();
+    }
+
+    LoopbackBroker(const LoopbackBroker &) = delete;
+    LoopbackBroker &operator=(const LoopbackBroker &) = delete;
+
+    unsigned short port() const { return acceptor_.local_endpoint().port(); }
+
+    // waits until the session is over (for most sessions: the client closed the connection)
+    void finish() { thread_.join(); }
+
+    // for a client that could not connect: connects and closes once itself so the session
+    // ends, then waits for it
+    void abandon() {
+        tcp::socket socket(service_);
+        boost::system::error_code error;
+        socket.connect(acceptor_.local_endpoint(), error);
+        socket.close(error);
+        finish();
+    }
+
+    // session that reads and discards everything until the client closes the connection
+    static void discard(tcp::socket &socket) {
+        char chunk[64 * 1024];
+        boost::system::error_code error;
+        while (!error)
+            socket.read_some(boost::asio::buffer(chunk), error);
+    }
+
+private:
+    boost::asio::io_service service_;
+    tcp::acceptor acceptor_;
+    Session session_;
+    std::thread thread_;
+
+    void run() {
+        tcp::socket socket(service_);
+        boost::system::error_code error;
+        acceptor_.accept(socket, error);
+        if (!error)
+            session_(socket);
+    }
+};
+
+// ---- checks: a test prints every check and exits with checkSummary() ----
+
+inline int &checkFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+inline void check(bool condition, const std::string &what) {
+    std::cout << (condition ? "  ok:   " : "  FAIL: ") << what << std::endl;
+    if (!condition)
+        checkFailures()++;
+}
+
+// the exit code of the test program
+inline int checkSummary() {
+    if (checkFailures() > 0) {
+        std::cout << checkFailures() << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "all checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Outbound lanes under a saturating report: a slow in-process broker (4 KB receive buffer)
+// reads a queue of bulk SENDs while SUBSCRIBE and DISCONNECT are queued behind them.
+//  - SUBSCRIBE (control lane) must overtake the bulk frames: its latency stays far below the
+//    time the whole queue needs to drain.
+//  - DISCONNECT (queueFinalFrame) must arrive after every SEND and be the last frame.
+// Runs in blocking and async mode; exits non-zero if any check failed.
+#include "../include/ConnectionHandler.h"
+#include "LoopbackBroker.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int BULK_FRAMES = 4000;
+static const size_t BULK_BODY = 512;
+
+static double msBetween(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(to - from).count();
+}
+
+// what the broker saw, in arrival order
+struct Arrival {
+    std::string command;
+    Clock::time_point at;
+};
+
+// reads the connection slowly until the client closes it, recording each frame's command
+static void readSlowly(LoopbackBroker::tcp::socket &socket, std::vector<Arrival> &arrivals) {
+    std::string pending;
+    char chunk[4096];
+    boost::system::error_code error;
+    while (true) {
+        size_t received = socket.read_some(boost::asio::buffer(chunk), error);
+        if (error)
+            break;
+        pending.append(chunk, received);
+        size_t end;
+        while ((end = pending.find('\0')) != std::string::npos) {
+            size_t start = pending.find_first_not_of("\r\n");
+            if (start < end) {
+                Arrival arrival = { pending.substr(start, pending.find('\n', start) - start), Clock::now() };
+                arrivals.push_back(arrival);
+            }
+            pending.erase(0, end + 1);
+        }
+        // a broker busy with something else: the client's queue backs up
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+static void runMode(IoMode mode, const char *name) {
+    std::cout << name << " mode:" << std::endl;
+    std::vector<Arrival> arrivals;   // filled by the broker thread, read after finish()
+    LoopbackBroker broker([&arrivals](LoopbackBroker::tcp::socket &socket) { readSlowly(socket, arrivals); }, 4096);
+    ConnectionHandler handler("127.0.0.1", broker.port(), mode);
+    handler.setOutboundLimits(0, 0); // the whole report queues up at once
+    // small kernel buffers: the backlog stays in the client's lanes, where it can be overtaken
+    SocketProfile profile;
+    profile.sendBufferSize = 8 * 1024;
+    handler.setSocketProfile(profile);
+    if (!handler.connect()) {
+        check(false, "connect to the test broker");
+        broker.abandon();
+        return;
+    }
+    std::thread ioThread;
+    if (mode == IoMode::Async) {
+        handler.startAsync([](const FrameView &) {}, [] {});
+        ioThread = std::thread([&handler] { handler.getIoService().run(); });
+    }
+
+    std::string body(BULK_BODY, 'x');
+    std::string send = "SEND\ndestination:/bulk\n\n" + body;
+    for (int i = 0; i < BULK_FRAMES; i++)
+        handler.queueFrameWithBackpressure(send, '\0');
+    Clock::time_point subscribeQueued = Clock::now();
+    check(handler.queueFrame("SUBSCRIBE\ndestination:/game\nid:1\n\n", '\0'), "SUBSCRIBE queued");
+    Clock::time_point disconnectQueued = Clock::now();
+    check(handler.queueFinalFrame("DISCONNECT\nreceipt:1\n\n", '\0'), "DISCONNECT queued");
+    check(!handler.queueFrame(send, '\0'), "queue refuses frames after DISCONNECT");
+    check(!handler.queueFinalFrame("DISCONNECT\nreceipt:2\n\n", '\0'), "only one final frame");
+
+    // the writer stops after DISCONNECT; the queue is empty once it is out
+    while (handler.getOutboundStats().queuedFrames > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    handler.close();
+    if (ioThread.joinable())
+        ioThread.join();
+    broker.finish();
+
+    int sendsBeforeSubscribe = -1, sendsBeforeDisconnect = 0, sends = 0;
+    Clock::time_point subscribeAt = subscribeQueued, disconnectAt = disconnectQueued;
+    for (const Arrival &arrival : arrivals) {
+        if (arrival.command == "SEND") {
+            sends++;
+        } else if (arrival.command == "SUBSCRIBE") {
+            sendsBeforeSubscribe = sends;
+            subscribeAt = arrival.at;
+        } else if (arrival.command == "DISCONNECT") {
+            sendsBeforeDisconnect = sends;
+            disconnectAt = arrival.at;
+        }
+    }
+    double subscribeMs = msBetween(subscribeQueued, subscribeAt);
+    double disconnectMs = msBetween(disconnectQueued, disconnectAt);
+    std::cout << "  SUBSCRIBE after " << sendsBeforeSubscribe << " of " << BULK_FRAMES << " SENDs, "
+              << subscribeMs << " ms; DISCONNECT after " << sendsBeforeDisconnect << " SENDs, "
+              << disconnectMs << " ms" << std::endl;
+
+    check(sends == BULK_FRAMES, "every SEND arrived");
+    check(sendsBeforeSubscribe >= 0 && sendsBeforeSubscribe < BULK_FRAMES / 4,
+          "SUBSCRIBE overtakes the bulk lane");
+    check(subscribeMs < disconnectMs / 4, "SUBSCRIBE latency well below the drain time");
+    check(!arrivals.empty() && arrivals.back().command == "DISCONNECT", "DISCONNECT is the last frame");
+    check(sendsBeforeDisconnect == BULK_FRAMES, "DISCONNECT follows every SEND");
+    check(handler.getIoStats().framesDropped == 0, "no frame dropped");
+}
+
+int main() {
+    runMode(IoMode::Blocking, "blocking");
+    runMode(IoMode::Async, "async");
+    return checkSummary();
+}